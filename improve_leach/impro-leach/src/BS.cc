@@ -14,6 +14,13 @@
 // 
 
 #include "BS.h"
+#include "sensor.h"
+
+#define WARM_SEED_STRIDE 100000 // seed-set offset between warm repetitions of a run
+#define METRICS_SLOTS 4096      // rounds kept in the metrics ring
+
+static const double latencyQuantiles[] = { 0.5, 0.95, 0.99 };
+static const char *latencyNames[] = { "p50", "p95", "p99" };
 
 Define_Module(BS);
 
@@ -23,25 +30,99 @@ void BS::initialize()
     N = getParentModule()->par("Nnodes");
 
     double edge = getParentModule()->par("edge");
-    range = sqrt(2*pow(edge,2));
+    diagonal = sqrt(2*pow(edge,2));
+    range = getParentModule()->par("range");
+    if(range < 0) range = diagonal;
+    multiHop = getParentModule()->par("multiHop");
+    sinr = getParentModule()->par("sinr");
+    if(sinr && N > 0)
+        channel.setModel(getSensors()[0]->par("gamma"), getParentModule()->par("sinrNoise"),
+                getParentModule()->par("sinrThreshold"), getParentModule()->par("sinrTheta"));
 
     bitrate = par("bitrate");
 
     startRound_e = new cMessage("start-round", START_ROUND);
+    adaptiveP = getParentModule()->par("adaptiveP");
+    if(adaptiveP)
+        startRound_e->setSchedulingPriority(-1); // P of the round is set before the nodes elect themselves
+    pVector.setName("electionP");
     rcvdJoin_e = new cMessage("check-JOIN-or-DATA", RCVD_JOIN);
+    snapshot_e = new cMessage("fork-snapshot", FORK_SNAPSHOT);
+    snapshot_e->setSchedulingPriority(-2); // fire before the nodes and the BS (adaptiveP) start the round
+    warmRestart_e = new cMessage("warm-restart", WARM_RESTART);
+    orphanWindow_e = new cMessage("orphan-JOIN-window", ORPHAN_WINDOW);
+    warmRepetitions = getParentModule()->par("warmRepetitions");
+    centralizedSetup = getParentModule()->par("centralizedSetup");
+    frameColoring = getParentModule()->par("frameColoring");
+    channels = getParentModule()->par("channels");
+    if(channels < 1) throw cRuntimeError("channels must be at least 1");
+    colorsVector.setName("frameColors");
+    roundTimeVector.setName("roundDuration");
+    batchedSetup = centralizedSetup || frameColoring || getParentModule()->par("batchedSetup").boolValue();
+    kmeans.setThreads(par("kmeansThreads").intValue());
+    kmeansVector.setName("kmeansIterations");
+    const char *elect = getParentModule()->par("election");
+    election = ElectionStrategy::create(elect);
+    if(!election) throw cRuntimeError("Unknown election '%s'", elect);
+    bool adaptiveFrames = getParentModule()->par("adaptiveFrames");
+    bool variant[] = { getParentModule()->par("slotMaxDistInCluster").boolValue() || adaptiveFrames, getParentModule()->par("useBSDist"),
+            getParentModule()->par("accountCHSetup"), getParentModule()->par("oneTxPerRound") };
+    earlyRoundEnd = adaptiveFrames && getParentModule()->par("oneTxPerRound").boolValue();
+    ops = PolicySelect<Ops, 4>::get(variant);
     // let BS set the restart round time for all the network
     getParentModule()->par("roundTime") = 1 + (N * propagationDelay(DATA_M_SIZE, MAX_DIST(range)));
 
-    scheduleAt(0,startRound_e);
+    // nodes have already been deployed (or restored) and registered their energy in the lifetime statistics
+    buildNeighbors();
+    lifetime.setFractions(cStringTokenizer(par("energyFractions")).asDoubleVector());
+    aliveVector.setName("aliveNodes");
+    const char *sink = par("ingest");
+    if(strlen(sink) > 0)
+        ingest.open(sink, par("ingestRingSize").intValue(), getParentModule()->par("aggregation"),
+                getParentModule()->par("sampleResolution"), getParentModule()->par("samplesPerReading"));
+    const char *ring = par("metricsRing");
+    if(strlen(ring) > 0 && !metrics.open(ring, METRICS_SLOTS, getEnvir()->getConfigEx()->getVariable("runid")))
+        throw cRuntimeError("Cannot map metrics ring '%s'", ring);
+    roundWall = std::chrono::steady_clock::now();
+    roundEvents = getSimulation()->getEventNumber();
+    for(int q = 0; q < 3; q++){
+        char name[64];
+        sprintf(name, "deliveryLatency:%s", latencyNames[q]);
+        latencyVector[q].setName(name);
+        sprintf(name, "clusterLatency:%s", latencyNames[q]);
+        clusterLatencyVector[q].setName(name);
+    }
 
+    forkRound = getParentModule()->par("forkRound");
+    const char *forkFile = getParentModule()->par("forkFile");
+    if((forkRound < 0) && (strlen(forkFile) > 0))
+    {
+        // continue a warm-up run: nodes restore their own state in Sensor::initialize()
+        std::shared_ptr<const NetSnapshot> snap = NetSnapshot::load(forkFile);
+        par("round") = snap->round - 1;
+        getParentModule()->par("round") = snap->round - 1;
+        getParentModule()->par("Ndead") = snap->Ndead;
+        if(snap->firstNodeDead() >= 0) recordScalar("firstNodeDead", snap->firstNodeDead());
+        lifetime.resume(snap->round); // all the nodes are in
+        scheduleAt(snap->time, startRound_e);
+    }
+    else
+        scheduleAt(0,startRound_e);
+}
 
+void BS::handleMessage(cMessage *msg)
+{
+    (this->*ops->handleMessage)(msg);
 }
 
+template<class Policy>
 void BS::handleMessage(cMessage *msg)
 {
     unsigned int Ndead = getParentModule()->par("Ndead");
 
-    if(Ndead < N)
+    if(msg == warmRestart_e)
+        startWarmRepetition();
+    else if(Ndead < N)
     {
         switch(msg->getKind())
         {
@@ -50,20 +131,53 @@ void BS::handleMessage(cMessage *msg)
                 // start a new round in LEACH
 
                 r = par("round"); // NOTE: par("round") starts at -1
+                if((frameColoring || earlyRoundEnd) && r >= 0)
+                    roundTimeVector.record(simTime() - roundStart);
+                roundStart = simTime();
+                endRound();
                 r++;
                 par("round") = r;
-                if (r == 0) roundTime = getParentModule()->par("roundTime");
+                if (roundTime == 0) roundTime = getParentModule()->par("roundTime"); // first round of this run
                 getParentModule()->par("round") = r; // let only BS node update also the net parameter
+                if(adaptiveP) adaptP<Policy>();
+                RoundArena::local().reset(); // scratch of the last round is dead by now
                 msgBuf.clear();
                 cancelEvent(rcvdJoin_e);
+                bsFrameStart = 0;
+                if(batchedSetup)
+                    formClusters();
+                if(frameColoring && Policy::oneTxPerRound){
+                    // the round lasts as long as its frames (with multiple TX per round, frames repeat until roundTime)
+                    roundTime = colorFrames<Policy>();
+                    getParentModule()->par("roundTime") = roundTime;
+                }
+                if(earlyRoundEnd){
+                    // the orphan frame stays open until the last orphan can have joined, so that the round does not end
+                    // before the orphans (or the CHs left without members) have been scheduled: ADV and JOIN timeout
+                    // of a CH, then its JOIN to us
+                    frameOpened(r);
+                    cancelEvent(orphanWindow_e);
+                    scheduleAt(simTime() + propagationDelay(ADV_M_SIZE, MAX_DIST(range)) + propagationDelay(JOIN_M_SIZE, MAX_DIST(range))
+                            + propagationDelay(JOIN_M_SIZE, MAX_DIST(diagonal)) + 3*EPSILON, orphanWindow_e);
+                }
                 // schedule the next round after roundTime
                 scheduleAt(simTime()+roundTime,startRound_e);
+                if(forkRound > 0 && r+1 == forkRound)
+                    scheduleAt(simTime()+roundTime,snapshot_e);
+                break;
+
+            case FORK_SNAPSHOT:
+                saveSnapshot();
+                break;
+
+            case ORPHAN_WINDOW:
+                frameClosed(r, simTime().dbl()); // the orphan frames scheduled by now hold the round open themselves
                 break;
 
             case RCVD_JOIN:
                 // wake up after timeout to check received ADVs
                 if(msgBuf.size() > 0)
-                    createTXSched();
+                    createTXSched<Policy>();
                 break;
             case JOIN_M:
                 if (msgBuf.size() == 0)
@@ -86,6 +200,10 @@ void BS::handleMessage(cMessage *msg)
                 //since they are going to serve as JOIN messages to create the new schedule
                 handleData(msg);
                 break;
+
+            case AGGREGATE_M:
+                handleAggregate(msg);
+                break;
         }
     }
 }
@@ -94,21 +212,89 @@ void BS::handleData(cMessage *msg)
 {
     mData *DATA = (mData *) msg;
     if (r == DATA->getRound()){
+        double ratio;
+        if(sinr && !channel.receive(DATA->getId(), 0, 0, ratio)){ // BS in (0,0) as in BS_DIST
+            EV << "data from " << DATA->getId() << " lost, SINR " << 10*log10(ratio) << " dB\n";
+            delete msg;
+            return;
+        }
         msgBuf.push_back(msg); // insert DATA into the message buffer
         EV << "received data from " << msg->getSenderModuleId() - 2 << "\n";
+
+        // an orphan is a cluster of its own
+        double latency = (simTime() - DATA->getCreated()).dbl();
+        roundLatency.add(latency);
+        clusterLatency.add(latency);
+
+        if(ingest.isOpen()){
+            IngestRecord rec;
+            rec.arrival = simTime().dbl();
+            rec.oldest = rec.newest = DATA->getCreated().dbl();
+            rec.ch = -1;
+            rec.round = DATA->getRound();
+            rec.repetition = warmRep;
+            rec.count = 1;
+            rec.payloadBytes = DATA->getSamples().size() * sizeof(float);
+            ingest.push(rec, DATA->getSamples().data());
+        }
     }
 }
 
+void BS::handleAggregate(cMessage *msg)
+{
+    // the readings of a cluster are between its oldest and newest one
+    mAggregate *AGGR = (mAggregate *) msg;
+    if(AGGR->getRound() == r){
+        double oldest = (simTime() - AGGR->getOldest()).dbl();
+        roundLatency.add(oldest);
+        if(AGGR->getCount() > 1)
+            roundLatency.add((simTime() - AGGR->getNewest()).dbl());
+        clusterLatency.add(oldest);
+    }
+    else
+        lateAggregates++; // the quantiles of its round are already out
+    EV << "received aggregate of " << AGGR->getCount() << " readings from " << AGGR->getId() << " (round " << AGGR->getRound() << ")\n";
+
+    if(ingest.isOpen()){
+        IngestRecord rec;
+        rec.arrival = simTime().dbl();
+        rec.oldest = AGGR->getOldest().dbl();
+        rec.newest = AGGR->getNewest().dbl();
+        rec.ch = AGGR->getId();
+        rec.round = AGGR->getRound();
+        rec.repetition = warmRep;
+        rec.count = AGGR->getCount();
+        rec.payloadBytes = AGGR->getPayload().size();
+        ingest.push(rec, AGGR->getPayload().data());
+    }
+    delete msg;
+}
+
+template<class Policy>
+double BS::orphanDist(int id)
+{
+    // distance at which the orphan transmits to us, see Sensor::bsDist()
+    NodeState s = sensors[id]->getState();
+    return Policy::useBSDist ? BS_DIST(s.x,s.y) : MAX_DIST(diagonal);
+}
+
+template<class Policy>
 void BS::createTXSched()
 {
     clusterN = msgBuf.size();
 
     // in order to adjust power of transmission, first keep track of the max_distance of nodes among the ones in the cluster
     sensor_max_dist = MAX_DIST(range);
+    if(Policy::slotMaxDistInCluster){
+        sensor_max_dist = 0;
+        for(unsigned int i = 0; i < msgBuf.size(); i++)
+            sensor_max_dist = std::max(sensor_max_dist, orphanDist<Policy>(((mJoin *) msgBuf.at(i))->getId()));
+    }
 
     // each node has to be assigned a temporal slot, based on msg DATA size they send and max propagation delay in the cluster
     double slot = propagationDelay(DATA_M_SIZE, sensor_max_dist);
     double SCHED_delay = propagationDelay(SCHED_M_SIZE, sensor_max_dist);
+    SCHED_delay += std::max(0.0, bsFrameStart - simTime().dbl()); // frame offset of the orphans (see colorFrames)
 
     // now send their SCHED information (i.e. their turn to transmit)
     for(unsigned int i = 0; i < msgBuf.size(); i++){
@@ -126,28 +312,525 @@ void BS::createTXSched()
 
     msgBuf.clear(); // empty buffer
 
+    if(phases.isOpen()){
+        double now = simTime().dbl();
+        phases.span("SCHED", -1, -1, now, now + propagationDelay(SCHED_M_SIZE, sensor_max_dist), r);
+        phases.span("TDMA frame", -1, -1, now + SCHED_delay, now + SCHED_delay + clusterN*slot + EPSILON, r);
+    }
 
+    if(earlyRoundEnd){
+        // the frame of the orphans is over when the last of them has transmitted
+        frameOpened(r);
+        frameClosed(r, simTime().dbl() + SCHED_delay + clusterN*slot + EPSILON);
+    }
 
-#ifndef ONE_TX_PER_ROUND
-    double IDLE_duration = clusterN*slot;
-    // setup a timer to keep radio in IDLE mode and receive all data (TDMA)
-    // Timeout will take in account the propagation delay for SCHED msg to reach destination and to receive back all data sequentially
-    scheduleAt(simTime() + SCHED_delay + IDLE_duration + EPSILON, rcvdJoin_e);
-    // after all data are collected, simply recompute the schedule based on new JOIN/DATA received
-#endif
+    if(!Policy::oneTxPerRound){
+        double IDLE_duration = clusterN*slot;
+        // setup a timer to keep radio in IDLE mode and receive all data (TDMA)
+        // Timeout will take in account the propagation delay for SCHED msg to reach destination and to receive back all data sequentially
+        scheduleAt(simTime() + SCHED_delay + IDLE_duration + EPSILON, rcvdJoin_e);
+        // after all data are collected, simply recompute the schedule based on new JOIN/DATA received
+    }
+}
+
+template<class Policy>
+void BS::adaptP()
+{
+    // With the single d^2 amplifier of Sensor::EnergyTX the energy of a round is
+    // minimized by k_opt = sqrt(N/(2*pi)) * M / d_toBS (Eelec, Eamp and Ecomp cancel out),
+    // with M the edge of the field and d_toBS the rms CH-to-BS distance
+    unsigned int alive = lifetime.getAlive();
+    if(alive == 0) return;
+    double edge = getParentModule()->par("edge");
+    double dBS2 = pow(MAX_DIST(diagonal),2);
+    if(Policy::useBSDist){
+        double sum = 0;
+        for(unsigned int n = 0; n < N; n++){
+            NodeState s = sensors[n]->getState();
+            if(s.role != DEAD) sum += pow(BS_DIST(s.x,s.y),2);
+        }
+        dBS2 = sum / alive;
+    }
+    double kopt = sqrt(alive / (2*M_PI)) * edge / sqrt(dBS2);
+    double P = std::min(1.0, std::max(1.0, kopt) / alive);
+    getParentModule()->par("P") = P;
+    pVector.record(P);
+}
+
+template<class Policy>
+double BS::colorFrames()
+{
+    // clusters of this round, the orphans are one more "cluster" around the BS
+    unsigned int K = formation.getNumCH();
+    clusterOf.assign(N, -1);
+    for(unsigned int k = 0; k < K; k++)
+        clusterOf[formation.getId(formation.getCHSlot(k))] = k;
+    ArenaVector<double> maxDist(K, 0, RoundArena::local());
+    ArenaVector<unsigned int> members(K, 0, RoundArena::local());
+    unsigned int orphans = 0;
+    double orphanMaxDist = 0;
+    for(unsigned int i = 0; i < formation.size(); i++){
+        if(formation.isClusterHead(i)) continue;
+        if(sensors[formation.getId(i)]->getState().role == DEAD) continue; // died sending its JOIN (see formClusters)
+        if(formation.getCH(i) < 0){
+            clusterOf[formation.getId(i)] = K;
+            orphans++;
+            orphanMaxDist = std::max(orphanMaxDist, orphanDist<Policy>(formation.getId(i)));
+            continue;
+        }
+        int k = clusterOf[formation.getCH(i)];
+        clusterOf[formation.getId(i)] = k;
+        maxDist[k] = std::max(maxDist[k], formation.getCHDist(i));
+        members[k]++;
+    }
+
+    // clusters with nodes in range of each other interfere; the orphans transmit to the far away BS and interfere with everyone
+    coloring.clear(orphans ? K+1 : K);
+    for(unsigned int k = 0; k < K && orphans; k++)
+        coloring.addEdge(k, K);
+    if(neighbors.isComplete()){
+        for(unsigned int a = 0; a < K; a++)
+            for(unsigned int b = a+1; b < K; b++)
+                coloring.addEdge(a, b);
+    }
+    else{
+        for(unsigned int n = 0; n < N; n++){
+            if(clusterOf[n] < 0 || clusterOf[n] == (int) K) continue;
+            for(NeighborGraph::Iterator m = neighbors.begin(n); m != neighbors.end(n); m++)
+                if(clusterOf[*m] >= 0 && clusterOf[*m] != (int) K) coloring.addEdge(clusterOf[n], clusterOf[*m]);
+        }
+    }
+    coloring.color();
+    colorsVector.record(coloring.getNumColors());
+
+    // frames as computed by Sensor::createTXSched and BS::createTXSched
+    frameLen.resize(coloring.size());
+    for(unsigned int k = 0; k < K; k++){
+        double slotDist = Policy::slotMaxDistInCluster ? maxDist[k] : MAX_DIST(range);
+        frameLen[k] = propagationDelay(SCHED_M_SIZE, slotDist) + members[k] * propagationDelay(DATA_M_SIZE, slotDist) + EPSILON;
+    }
+    if(orphans){
+        double slotDist = Policy::slotMaxDistInCluster ? orphanMaxDist : MAX_DIST(range);
+        frameLen[K] = propagationDelay(SCHED_M_SIZE, slotDist) + orphans * propagationDelay(DATA_M_SIZE, slotDist) + EPSILON;
+    }
+
+    // colors share a time group if they have different channels; groups follow each other
+    unsigned int groups = (coloring.getNumColors() + channels - 1) / channels;
+    ArenaVector<double> groupStart(groups + 1, 0, RoundArena::local());
+    for(unsigned int k = 0; k < coloring.size(); k++){
+        int g = coloring.getColor(k) / channels;
+        groupStart[g+1] = std::max(groupStart[g+1], frameLen[k] + EPSILON);
+    }
+    for(unsigned int g = 0; g < groups; g++)
+        groupStart[g+1] += groupStart[g];
+
+    // all the JOINs are in after the ADV and JOIN delays
+    double setup = propagationDelay(ADV_M_SIZE, MAX_DIST(diagonal)) + propagationDelay(JOIN_M_SIZE, MAX_DIST(diagonal)) + 2*EPSILON;
+    double start = simTime().dbl() + setup;
+    for(unsigned int k = 0; k < coloring.size(); k++){
+        double frame = start + groupStart[coloring.getColor(k) / channels];
+        if(k < K)
+            sensors[formation.getId(formation.getCHSlot(k))]->setFrameStart(frame);
+        else
+            bsFrameStart = frame;
+    }
+    if(sinr){
+        for(unsigned int n = 0; n < N; n++)
+            if(clusterOf[n] >= 0) channel.setNodeChannel(n, coloring.getColor(clusterOf[n]) % channels);
+    }
+
+    // each CH uploads at the end of its frame: the largest aggregate of the cluster (see Sensor::compressAndSendToBS)
+    // over the path of the CH to the BS
+    ClusterAggregator *agg = getAggregator();
+    int samples = getParentModule()->par("samplesPerReading");
+    double end = groupStart[groups];
+    for(unsigned int k = 0; k < K; k++){
+        unsigned int bits = agg ? AGGR_HEADER_SIZE + 8*agg->maxPayloadBytes(members[k], samples) : DATA_M_SIZE;
+        end = std::max(end, groupStart[coloring.getColor(k) / channels] + frameLen[k] + uploadDelay(formation.getId(formation.getCHSlot(k)), bits));
+    }
+    return setup + end + EPSILON;
+}
+
+void BS::formClusters()
+{
+    // election, CH choice and JOINs of all the nodes in this event
+    formation.clear();
+    for(unsigned int n = 0; n < N; n++){
+        if(!sensors[n]->beginBatchedRound()) continue; // dead
+        NodeState s = sensors[n]->getState();
+        formation.add(n, s.x, s.y, s.energy, sensors[n]->getInitialEnergy(), s.alreadyCH);
+    }
+
+    double P = getParentModule()->par("P");
+    if(centralizedSetup)
+    {
+        // LEACH-C: P*alive clusters
+        unsigned int k = std::max(1, (int) round(P * formation.size()));
+        formation.electCentralized(k, kmeans);
+        kmeansVector.record(kmeans.getIterations());
+    }
+    else
+    {
+        // thresholds of all the nodes in one pass, then the same draws as the per-node
+        // elections: in node order, each from the RNG mapped to its node
+        election->beginRound(r, P, lifetime);
+        formation.computeThresholds(*election);
+        chance.resize(formation.size());
+        for(unsigned int i = 0; i < formation.size(); i++)
+            chance[i] = sensors[formation.getId(i)]->uniform(0,1);
+        formation.elect(chance.data());
+    }
+    formation.assign(r, MAX_DIST(range));
+
+    // JOINs first: a member that runs out of energy sending it does not join
+    for(unsigned int i = 0; i < formation.size(); i++)
+        if(!formation.isClusterHead(i))
+            sensors[formation.getId(i)]->applyMembership(formation.getCH(i), formation.getCHDist(i));
+    ArenaVector<int> joined(RoundArena::local());
+    for(unsigned int k = 0; k < formation.getNumCH(); k++){
+        const int *members = formation.getMembers(k);
+        joined.clear();
+        for(unsigned int m = 0; m < formation.getNumMembers(k); m++)
+            if(sensors[members[m]]->getState().role != DEAD) joined.push_back(members[m]);
+        unsigned int slot = formation.getCHSlot(k);
+        sensors[formation.getId(slot)]->applyClusterHead(joined.data(), joined.size());
+    }
+}
+
+void BS::buildNeighbors()
+{
+    std::vector<double> nx(N), ny(N);
+    for(unsigned int n = 0; n < N; n++){
+        NodeState s = sensors[n]->getState();
+        nx[n] = s.x;
+        ny[n] = s.y;
+    }
+    neighbors.build(nx.data(), ny.data(), N, range);
+    for(unsigned int n = 0; n < N; n++)
+        if(sensors[n]->getState().role == DEAD) neighbors.remove(n); // resumed from a snapshot
+    EV << "Radio range " << range << " m, mean node degree " << neighbors.getMeanDegree() << "\n";
+
+    if(multiHop && N > 0){
+        // aggregates are DATA_M_SIZE bits (see Sensor::compressAndSendToBS), BS in (0,0) as in BS_DIST
+        routes.setRadio(sensors[0]->par("Eelec"), sensors[0]->par("Eamp"), DATA_M_SIZE);
+        routes.build(neighbors, nx.data(), ny.data(), 0, 0);
+    }
+}
+
+void BS::saveSnapshot()
+{
+    // all the nodes are between two rounds: save their state and stop the warm-up run
+    // the radio energy is only charged on a change of state, take what is pending first
+    for(unsigned int n = 0; n < N; n++)
+        getSensors()[n]->chargeRadio();
+    NetSnapshot snap;
+    snap.round = forkRound;
+    snap.time = simTime().dbl();
+    snap.Ndead = getParentModule()->par("Ndead");
+    for(unsigned int n = 0; n < N; n++){
+        Sensor *sensor = check_and_cast<Sensor *>(retrieveNode(n));
+        snap.nodes.push_back(sensor->getState());
+    }
+    const char *forkFile = getParentModule()->par("forkFile");
+    snap.save(forkFile);
+    EV << "Network state at round " << forkRound << " saved to " << forkFile << "\n";
+    endSimulation();
+}
+
+void BS::endRound()
+{
+    // alive-count curve: one value per round instead of one per energy event
+    if(r < 0) return;
+    lifetime.endRound(r);
+    aliveVector.record(lifetime.getAlive());
+    if(metrics.isOpen()) publishMetrics();
+
+    // latency of the deliveries of the round
+    if(roundLatency.getCount() > 0)
+        for(int q = 0; q < 3; q++)
+            latencyVector[q].record(roundLatency.quantile(latencyQuantiles[q]));
+    if(clusterLatency.getCount() > 0)
+        for(int q = 0; q < 3; q++)
+            clusterLatencyVector[q].record(clusterLatency.quantile(latencyQuantiles[q]));
+    runLatency.merge(roundLatency);
+    runClusterLatency.merge(clusterLatency);
+    roundLatency.reset();
+    clusterLatency.reset();
+}
+
+void BS::publishMetrics()
+{
+    // one slot of the shared ring per round
+    std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+    double wall = std::chrono::duration<double>(now - roundWall).count();
+    eventnumber_t events = getSimulation()->getEventNumber();
+    unsigned int chs = (unsigned int) r < chPerRound.size() ? chPerRound[r] : 0;
+    metrics.publish(r, lifetime.getAlive(), lifetime.getResidualEnergy(), chs, simTime().dbl(),
+            wall > 0 ? (events - roundEvents) / wall : 0, wall);
+    roundWall = now;
+    roundEvents = events;
+}
+
+void BS::networkDead()
+{
+    Enter_Method_Silent(); // called by the last node to die
+    // leave roundTime to messages still in flight, then restart on the same modules
+    if(warmRep+1 < warmRepetitions)
+        scheduleAt(simTime()+roundTime, warmRestart_e);
+    else
+        endSimulation();
+}
+
+void BS::startWarmRepetition()
+{
+    endRound();
+    lifetime.endRun();
+    lifetime.resetRun();
+    warmRep++;
+    EV << "Starting warm repetition " << warmRep << "\n";
+
+    // each repetition draws from its own seed set
+    int seedSet = atoi(getEnvir()->getConfigEx()->getVariable("seedset")) + warmRep*WARM_SEED_STRIDE;
+    for(int k = 0; k < getEnvir()->getNumRNGs(); k++)
+        getEnvir()->getRNG(k)->initialize(seedSet, k, getEnvir()->getNumRNGs(), 0, 1, getEnvir()->getConfig());
+
+    r = -1;
+    par("round") = r;
+    getParentModule()->par("round") = r;
+    chPerRound.clear();
+    getParentModule()->par("Ndead") = 0;
+    for(unsigned int i = 0; i < msgBuf.size(); i++)
+        delete msgBuf[i];
+    msgBuf.clear();
+    cancelEvent(rcvdJoin_e);
+    cancelEvent(orphanWindow_e);
+    channel.reset();
+
+    for(unsigned int n = 0; n < N; n++)
+        check_and_cast<Sensor *>(retrieveNode(n))->fullReset();
+    buildNeighbors(); // nodes have been deployed again
+    cancelEvent(startRound_e);
+    scheduleAt(simTime(), startRound_e);
+}
+
+void BS::recordMoments(const char *name, const RunMoments &m)
+{
+    if(m.n == 0) return;
+    char buf[64];
+    double var = m.n > 1 ? (m.sumSq - m.n*m.mean()*m.mean()) / (m.n - 1) : 0;
+    sprintf(buf, "%s:mean", name); recordScalar(buf, m.mean());
+    sprintf(buf, "%s:stddev", name); recordScalar(buf, sqrt(std::max(0.0, var)));
+    sprintf(buf, "%s:min", name); recordScalar(buf, m.min);
+    sprintf(buf, "%s:max", name); recordScalar(buf, m.max);
+    sprintf(buf, "%s:count", name); recordScalar(buf, m.n);
+}
+
+void BS::recordQuantiles(const char *name, const StreamingHistogram &h)
+{
+    if(h.getCount() == 0) return;
+    char buf[64];
+    for(int q = 0; q < 3; q++){
+        sprintf(buf, "%s:%s", name, latencyNames[q]);
+        recordScalar(buf, h.quantile(latencyQuantiles[q]));
+    }
+    sprintf(buf, "%s:mean", name); recordScalar(buf, h.getMean());
+    sprintf(buf, "%s:max", name); recordScalar(buf, h.getMax());
 }
 
 void BS::finish(){
+    delete election;
+    delete trace;
+    trace = nullptr;
+    metrics.close();
+    if(phases.isOpen()){
+        recordScalar("phaseEvents", phases.getEvents());
+        phases.close();
+    }
+    if(ingest.isOpen()){
+        ingest.close(); // waits for the consumer to drain the ring
+        recordScalar("ingestPushed", ingest.getPushed());
+        recordScalar("ingestDropped", ingest.getDropped());
+        recordScalar("ingestWritten", ingest.getWritten());
+    }
+    cancelAndDelete(snapshot_e);
+    cancelAndDelete(warmRestart_e);
+    cancelAndDelete(orphanWindow_e);
     recordScalar("endTime", simTime());
     recordScalar("rounds", r);
+    if(sinr){
+        // over all the warm repetitions
+        recordScalar("dataReceived", channel.getReceived());
+        recordScalar("dataLost", channel.getLost());
+    }
+
+    endRound();
+    lifetime.endRun();
+    // over all the warm repetitions
+    recordQuantiles("deliveryLatency", runLatency);
+    recordQuantiles("clusterLatency", runClusterLatency);
+    recordScalar("lateAggregates", lateAggregates);
+    if(aggregator.getAggregates() > 0){
+        recordScalar("aggregates", aggregator.getAggregates());
+        recordScalar("aggregatePayloadBits:mean", 8*aggregator.getPayloadBytes() / aggregator.getAggregates());
+        if(aggregator.getPayloadBytes() > 0)
+            recordScalar("aggregationRatio", aggregator.getRawBytes() / aggregator.getPayloadBytes());
+        recordScalar("aggregationCPUTime", aggregator.getCPUTime());
+    }
+    if(warmRepetitions > 1)
+    {
+        // one value per warm repetition, merged
+        recordScalar("warmRepetitions", lifetime.getRuns());
+        recordMoments("FND", lifetime.getMergedFND());
+        recordMoments("HND", lifetime.getMergedHND());
+        recordMoments("LND", lifetime.getMergedLND());
+        for(unsigned int i = 0; i < lifetime.getFractions().size(); i++){
+            char name[64];
+            sprintf(name, "roundsToEnergy%gpct", 100*lifetime.getFractions()[i]);
+            recordMoments(name, lifetime.getMergedRoundsToFraction(i));
+        }
+        // mean alive curve, by round (repetitions already over count as 0 alive)
+        cOutVector meanAlive("aliveNodes:mean");
+        const std::vector<double> &aliveSum = lifetime.getAliveSum();
+        for(unsigned int round = 0; round < aliveSum.size(); round++)
+            meanAlive.recordWithTimestamp(round, aliveSum[round] / lifetime.getRuns());
+        return;
+    }
+    if(lifetime.getFND() >= 0) recordScalar("FND", lifetime.getFND());
+    if(lifetime.getHND() >= 0) recordScalar("HND", lifetime.getHND());
+    if(lifetime.getLND() >= 0) recordScalar("LND", lifetime.getLND());
+    for(unsigned int i = 0; i < lifetime.getFractions().size(); i++){
+        if(lifetime.getRoundsToFraction(i) < 0) continue; // threshold not reached
+        char name[64];
+        sprintf(name, "roundsToEnergy%gpct", 100*lifetime.getFractions()[i]);
+        recordScalar(name, lifetime.getRoundsToFraction(i));
+    }
+}
+
+LifetimeStats *BS::getLifetime()
+{
+    return &lifetime;
+}
+
+ClusterHeadIndex *BS::getCHIndex()
+{
+    return &chIndex;
+}
+
+NeighborGraph *BS::getNeighbors()
+{
+    return &neighbors;
+}
+
+void BS::clusterHeadElected(int round)
+{
+    // counted by round: nodes may already be in the next round when the BS closes this one
+    if(round < 0) return;
+    if((unsigned int) round >= chPerRound.size()) chPerRound.resize(round + 1, 0);
+    chPerRound[round]++;
+}
+
+void BS::frameOpened(int round)
+{
+    Enter_Method_Silent(); // called by the CHs
+    if(round != frameRound){
+        // first frame of the round (nodes may start the round before the BS)
+        frameRound = round;
+        openFrames = 0;
+        roundEnd = 0;
+    }
+    openFrames++;
+}
+
+void BS::frameClosed(int round, double arrival)
+{
+    Enter_Method_Silent();
+    if(round != frameRound || openFrames == 0) return;
+    roundEnd = std::max(roundEnd, arrival);
+    if(--openFrames > 0) return;
+
+    // all the aggregates are in: start the next round now instead of after roundTime
+    simtime_t next = roundEnd + EPSILON;
+    if(!startRound_e->isScheduled() || next >= startRound_e->getArrivalTime()) return;
+    if(!batchedSetup){
+        // nodes first, so that they keep starting the round before the BS
+        for(unsigned int n = 0; n < N; n++)
+            sensors[n]->startRoundAt(next);
+    }
+    cancelEvent(startRound_e);
+    scheduleAt(next, startRound_e);
+    if(snapshot_e->isScheduled()){
+        cancelEvent(snapshot_e);
+        scheduleAt(next, snapshot_e);
+    }
+}
+
+InterferenceChannel *BS::getChannel()
+{
+    return getParentModule()->par("sinr").boolValue() ? &channel : nullptr;
+}
+
+ClusterAggregator *BS::getAggregator()
+{
+    // nodes ask before BS::initialize()
+    if(getParentModule()->par("samplesPerReading").intValue() <= 0) return nullptr;
+    if(!aggregatorReady){
+        const char *ops = getParentModule()->par("aggregation");
+        if(!aggregator.setOperators(ops)) throw cRuntimeError("Unknown aggregation '%s'", ops);
+        aggregator.setResolution(getParentModule()->par("sampleResolution"));
+        aggregatorReady = true;
+    }
+    return &aggregator;
+}
+
+TraceSource *BS::getTrace()
+{
+    // nodes ask before BS::initialize()
+    int samples = getParentModule()->par("samplesPerReading");
+    if(samples <= 0) return nullptr;
+    if(!trace){
+        const char *traceFile = getParentModule()->par("traceFile");
+        if(strlen(traceFile) > 0)
+            trace = new FileTrace(traceFile, getParentModule()->par("Nnodes").intValue(), samples);
+        else{
+            // the same field for all the runs of a seed set
+            SyntheticTrace *field = new SyntheticTrace();
+            field->setField(getParentModule()->par("edge").doubleValue(), atoi(getEnvir()->getConfigEx()->getVariable("seedset")));
+            trace = field;
+        }
+    }
+    return trace;
+}
+
+PhaseTrace *BS::getPhaseTrace()
+{
+    // nodes ask before BS::initialize()
+    const char *file = par("phaseTrace");
+    if(strlen(file) == 0) return nullptr;
+    if(!phases.isOpen()) phases.open(file);
+    return &phases;
+}
+
+RoutingTree *BS::getRoutes()
+{
+    // nodes ask before BS::initialize()
+    return getParentModule()->par("multiHop").boolValue() ? &routes : nullptr;
+}
+
+const std::vector<Sensor *> &BS::getSensors()
+{
+    // filled by the first caller, usually a node initializing before the BS
+    if(sensors.empty()){
+        int n = getParentModule()->par("Nnodes");
+        for(int i = 0; i < n; i++)
+            sensors.push_back(check_and_cast<Sensor *>(getParentModule()->getSubmodule("node", i)));
+    }
+    return sensors;
 }
 
 /********* Utilities ************/
 cModule* BS::retrieveNode(unsigned int n)
 {
-   char modName[32];
-   sprintf(modName,"node[%d]", n);
-   return (cModule *) getModuleByPath(modName);
+   return getSensors()[n];
 }
 
 
@@ -159,11 +842,27 @@ double BS::propagationDelay(unsigned int msg_size, double dist)
     return dist/C + Dp;  // propagation delay
 }
 
+double BS::uploadDelay(int id, unsigned int k)
+{
+    // k bits from node id to the BS, hop by hop on the min-energy tree (see Sensor::forwardToBS)
+    if(!multiHop) return propagationDelay(k, MAX_DIST(diagonal));
+    double delay = 0;
+    for(int n = id; n >= 0; n = routes.getNextHop(n))
+        delay += propagationDelay(k, routes.getHopDist(n));
+    return delay;
+}
+
 void BS::broadcast(cMessage *msg, double delay){
     for(unsigned int n = 0; n < N; n++){
+        if(!neighbors.isAlive(n)) continue; // dead nodes would drop it
         cModule * sensor = retrieveNode(n);
         sendDirect(msg->dup(), delay, 0,  sensor->gate("in"));
     }
 }
 
-
+template<class Policy>
+const BS::Ops *BS::Ops::get()
+{
+    static const Ops ops = { &BS::handleMessage<Policy> };
+    return &ops;
+}
@@ -16,11 +16,29 @@
 #ifndef __IMPRO_LEACH_BS_H_
 #define __IMPRO_LEACH_BS_H_
 
+#include <chrono>
+#include <cstring>
 #include <omnetpp.h>
 #include "common.h"
+#include "snapshot.h"
+#include "lifetime.h"
+#include "chindex.h"
+#include "clustering.h"
+#include "arena.h"
+#include "neighbors.h"
+#include "routing.h"
+#include "sinr.h"
+#include "coloring.h"
+#include "histogram.h"
+#include "trace.h"
+#include "ingest.h"
+#include "metrics.h"
+#include "phasetrace.h"
 
 using namespace omnetpp;
 
+class Sensor;
+
 /**
  * Base Station class
  */
@@ -30,31 +48,123 @@ class BS : public cSimpleModule
 
     unsigned int N;         // nodes in the network
     int x,y;                // coordinates of sensor (m)
-    double roundTime;
+    double roundTime = 0;
     int r;
     double C = LIGHTSPEED;
     double bitrate;   // bitrate of sensors
-    double range;        // it will be the max communication range of sensors
+    double range;        // radio range of sensors
+    double diagonal;     // diagonal of the field
     unsigned int clusterN;  // used by BD to keep track of the num. of nodes in the cluster
     double sensor_max_dist; // used by CH to adjust power of transmission
+    int forkRound;          // round at which the warm-up run saves the network state
+    int warmRepetitions;    // repetitions simulated on the same module tree
+    int warmRep = 0;        // current warm repetition
+    bool batchedSetup;      // run the setup phase of all the nodes in the START_ROUND event
+    bool centralizedSetup;  // LEACH-C: CHs chosen by the BS
+    bool adaptiveP;         // set P from k_opt at the start of each round
+
+    // protocol variant, chosen once in initialize() (see LeachPolicy)
+    struct Ops
+    {
+        typedef const Ops *type;
+        void (BS::*handleMessage)(cMessage *msg);
+        template<class Policy> static const Ops *get();
+    };
+    const Ops *ops;
 
     cMessage *startRound_e;
     cMessage *rcvdJoin_e;   // event used to wake up and check JOIN msgs from sensor nodes
+    cMessage *snapshot_e;   // event used to save the network state before nodes start forkRound
+    cMessage *warmRestart_e; // event used to start the next warm repetition
+    cMessage *orphanWindow_e; // event used to close the orphan frame of the round once all the orphan JOINs are in (earlyRoundEnd)
 
 
     std::vector<cMessage *> msgBuf;
 
+    LifetimeStats lifetime; // updated directly by the nodes
+    cOutVector aliveVector; // alive nodes at the end of each round
+    ClusterHeadIndex chIndex; // CHs elected in the current round
+    ClusterFormation formation; // batched setup phase
+    std::vector<Sensor *> sensors;
+    NeighborGraph neighbors; // nodes in radio range of each other
+    bool multiHop;          // CH aggregates relayed over the min-energy tree
+    RoutingTree routes;     // min-energy paths to the BS
+    bool sinr;              // DATA received only above the SINR threshold
+    InterferenceChannel channel; // concurrent DATA transmissions
+    bool frameColoring;     // interfering clusters get different channels or frame offsets
+    int channels;           // frequency channels for frameColoring
+    FrameColoring coloring; // clusters (and the BS frame of the orphans) by adjacency
+    std::vector<int> clusterOf; // cluster of each node in the current round
+    std::vector<double> frameLen; // TDMA frame of each cluster
+    double bsFrameStart = 0; // start of the frame of the orphans
+    cOutVector colorsVector; // colors of each round
+    cOutVector roundTimeVector; // duration of each round
+    bool earlyRoundEnd;     // adaptiveFrames: the next round starts when the last aggregate is in
+    int frameRound = -1;    // round of openFrames
+    unsigned int openFrames = 0; // frames of the round not over yet
+    double roundEnd = 0;    // arrival of the last aggregate of the round
+    simtime_t roundStart;
+    std::vector<double> chance;
+    KMeans kmeans;          // LEACH-C centroids, warm-started from the previous round
+    ElectionStrategy *election; // thresholds of the batched setup
+    cOutVector kmeansVector; // k-means iterations of each round
+    cOutVector pVector;     // P of each round
+    // delivery latency: every orphan reading, and only the oldest and newest reading of each aggregate
+    // (the creation times in between do not reach the BS), so not weighted by the readings of the cluster
+    StreamingHistogram roundLatency;   // delivery latency of this round
+    StreamingHistogram clusterLatency; // latency of the oldest reading of each cluster this round
+    StreamingHistogram runLatency, runClusterLatency; // the same over all the rounds
+    cOutVector latencyVector[3], clusterLatencyVector[3]; // quantiles of each round
+    unsigned long lateAggregates = 0; // arrived after their round was over, left out of the latencies
+    ClusterAggregator aggregator; // shared by the CHs (one at a time)
+    bool aggregatorReady = false;
+    TraceSource *trace = nullptr; // readings of the nodes
+    IngestSink ingest;      // received aggregates, exported by a consumer thread
+    MetricsRing metrics;    // live per-round metrics for tools/leachtop
+    std::vector<unsigned int> chPerRound; // CHs elected in each round
+    std::chrono::steady_clock::time_point roundWall; // wall clock at the end of the last round
+    eventnumber_t roundEvents = 0; // event number at the end of the last round
+    PhaseTrace phases;      // round phases of the clusters, written by the nodes
+
 
   protected:
     virtual void initialize();
     virtual void finish();
     virtual void handleMessage(cMessage *msg);
+    template<class Policy> void handleMessage(cMessage *msg);
     virtual cModule* retrieveNode(unsigned int n);
     virtual double propagationDelay(unsigned int msg_size, double dist);
     virtual void broadcast(cMessage *msg, double delay);
-    virtual void createTXSched();
+    template<class Policy> void createTXSched();
     virtual void handleData(cMessage *msg);
+    virtual void handleAggregate(cMessage *msg);
+    virtual void recordQuantiles(const char *name, const StreamingHistogram &h);
+    virtual void publishMetrics();
+    virtual void saveSnapshot();
+    virtual void endRound();
+    virtual void startWarmRepetition();
+    virtual void recordMoments(const char *name, const RunMoments &m);
+    virtual void formClusters();
+    virtual void buildNeighbors();
+    template<class Policy> void adaptP();
+    template<class Policy> double colorFrames();
+    template<class Policy> double orphanDist(int id);
+    virtual double uploadDelay(int id, unsigned int k);
 
+  public:
+    virtual LifetimeStats *getLifetime();
+    virtual ClusterHeadIndex *getCHIndex();
+    virtual const std::vector<Sensor *> &getSensors();
+    virtual NeighborGraph *getNeighbors();
+    virtual RoutingTree *getRoutes();
+    virtual InterferenceChannel *getChannel();
+    virtual ClusterAggregator *getAggregator();
+    virtual TraceSource *getTrace();
+    virtual PhaseTrace *getPhaseTrace();
+    virtual void clusterHeadElected(int round);
+    virtual void frameOpened(int round);
+    virtual void frameClosed(int round, double arrival);
+    virtual void networkDead();
 };
 
 #endif
@@ -0,0 +1,170 @@
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with this program.  If not, see http://www.gnu.org/licenses/.
+//
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <string>
+#include "aggregation.h"
+#include "codec.h"
+
+#define AGG_HIST_BINS 16 // bins of the histogram operator
+#define AGG_MAX_VALUE_BYTES 10 // longest varint of an encoded value (64 bit)
+
+enum AggregateOp {
+    AGG_MIN,
+    AGG_MAX,
+    AGG_MEAN,
+    AGG_HISTOGRAM,
+    AGG_DELTA
+};
+
+/********* kernels **********/
+static void minInto(float *__restrict acc, const float *__restrict v, unsigned int n)
+{
+    for(unsigned int i = 0; i < n; i++)
+        acc[i] = v[i] < acc[i] ? v[i] : acc[i];
+}
+
+static void maxInto(float *__restrict acc, const float *__restrict v, unsigned int n)
+{
+    for(unsigned int i = 0; i < n; i++)
+        acc[i] = v[i] > acc[i] ? v[i] : acc[i];
+}
+
+static void addInto(float *__restrict acc, const float *__restrict v, unsigned int n)
+{
+    for(unsigned int i = 0; i < n; i++)
+        acc[i] += v[i];
+}
+
+static void scale(float *__restrict v, float s, unsigned int n)
+{
+    for(unsigned int i = 0; i < n; i++)
+        v[i] *= s;
+}
+
+static void binIndex(int32_t *__restrict bin, const float *__restrict v, unsigned int n, float lo, float perBin)
+{
+    for(unsigned int i = 0; i < n; i++){
+        int32_t b = (int32_t) ((v[i] - lo) * perBin);
+        b = b < 0 ? 0 : b;
+        bin[i] = b > AGG_HIST_BINS-1 ? AGG_HIST_BINS-1 : b;
+    }
+}
+
+static void quantize(int64_t *__restrict q, const float *__restrict v, unsigned int n, double inv)
+{
+    for(unsigned int i = 0; i < n; i++)
+        q[i] = (int64_t) floor(v[i] * inv + 0.5);
+}
+
+/********* aggregator **********/
+bool ClusterAggregator::setOperators(const char *list)
+{
+    static const char *names[] = { "min", "max", "mean", "histogram", "delta" };
+    ops.clear();
+    std::string s(list);
+    for(size_t pos = 0; pos < s.size(); ){
+        size_t end = s.find_first_of(" ,", pos);
+        if(end == std::string::npos) end = s.size();
+        std::string name = s.substr(pos, end - pos);
+        pos = end + 1;
+        if(name.empty()) continue;
+        int op = std::find(names, names + 5, name) - names;
+        if(op == 5) return false;
+        ops.push_back(op);
+    }
+    return true;
+}
+
+void ClusterAggregator::encode(const float *v, unsigned int n)
+{
+    quantized.resize(n);
+    quantize(quantized.data(), v, n, 1 / resolution);
+    encodeDeltaInts(payload, quantized.data(), n);
+}
+
+unsigned int ClusterAggregator::aggregate(const float *const *members, unsigned int m, unsigned int n)
+{
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    payload.clear();
+    if(m > 0 && n > 0){
+        bool needLo = false, needHi = false, needSum = false;
+        for(unsigned int k = 0; k < ops.size(); k++){
+            needLo |= ops[k] == AGG_MIN || ops[k] == AGG_HISTOGRAM;
+            needHi |= ops[k] == AGG_MAX || ops[k] == AGG_HISTOGRAM;
+            needSum |= ops[k] == AGG_MEAN;
+        }
+
+        // element-wise reductions, one pass per member
+        if(needLo) lo.assign(members[0], members[0] + n);
+        if(needHi) hi.assign(members[0], members[0] + n);
+        if(needSum) sum.assign(members[0], members[0] + n);
+        for(unsigned int j = 1; j < m; j++){
+            if(needLo) minInto(lo.data(), members[j], n);
+            if(needHi) maxInto(hi.data(), members[j], n);
+            if(needSum) addInto(sum.data(), members[j], n);
+        }
+        if(needSum) scale(sum.data(), 1.0f / m, n);
+
+        for(unsigned int k = 0; k < ops.size(); k++){
+            switch(ops[k]){
+                case AGG_MIN: encode(lo.data(), n); break;
+                case AGG_MAX: encode(hi.data(), n); break;
+                case AGG_MEAN: encode(sum.data(), n); break;
+                case AGG_HISTOGRAM: {
+                    float range[2] = { *std::min_element(lo.begin(), lo.end()), *std::max_element(hi.begin(), hi.end()) };
+                    float perBin = range[1] > range[0] ? AGG_HIST_BINS / (range[1] - range[0]) : 0;
+                    counts.assign(AGG_HIST_BINS, 0);
+                    bins.resize(n);
+                    for(unsigned int j = 0; j < m; j++){
+                        binIndex(bins.data(), members[j], n, range[0], perBin);
+                        for(unsigned int i = 0; i < n; i++)
+                            counts[bins[i]]++;
+                    }
+                    encode(range, 2);
+                    encodeDeltaInts(payload, counts.data(), AGG_HIST_BINS);
+                    break;
+                }
+                case AGG_DELTA:
+                    for(unsigned int j = 0; j < m; j++)
+                        encode(members[j], n);
+                    break;
+            }
+        }
+    }
+    aggregates++;
+    rawBytes += (double) m * n * sizeof(float);
+    payloadBytes += payload.size();
+    cpuTime += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    return payload.size();
+}
+
+unsigned int ClusterAggregator::maxPayloadBytes(unsigned int m, unsigned int n) const
+{
+    // the values aggregate() writes, each at its longest varint
+    if(m == 0 || n == 0) return 0;
+    unsigned int values = 0;
+    for(unsigned int k = 0; k < ops.size(); k++){
+        switch(ops[k]){
+            case AGG_MIN: case AGG_MAX: case AGG_MEAN: values += n; break;
+            case AGG_HISTOGRAM: values += 2 + AGG_HIST_BINS; break;
+            case AGG_DELTA: values += m*n; break;
+        }
+    }
+    return values * AGG_MAX_VALUE_BYTES;
+}
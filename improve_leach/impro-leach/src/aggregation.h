@@ -0,0 +1,75 @@
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with this program.  If not, see http://www.gnu.org/licenses/.
+//
+
+#ifndef __IMPRO_LEACH_AGGREGATION_H_
+#define __IMPRO_LEACH_AGGREGATION_H_
+
+#include <cstdint>
+#include <vector>
+
+// samples carried by a DATA message
+typedef std::vector<float> SampleVector;
+// encoded aggregate carried to the BS
+typedef std::vector<uint8_t> PayloadBytes;
+
+/**
+ * Aggregation of the DATA payloads of a cluster at its CH, with the
+ * operators listed in the Base_net "aggregation" parameter:
+ *   min, max, mean  element-wise over the members, one value per sample
+ *   histogram       AGG_HIST_BINS counts of all the samples between their min and max
+ *   delta           the samples of every member, quantized to the resolution
+ * Values are quantized to the resolution and written as zig-zag varints of
+ * the delta with the previous value (see codec.h); the encoded size is what
+ * the CH transmits to the BS.
+ *
+ * The kernels go over contiguous float arrays one member at a time with no
+ * branches, so that the compiler vectorizes them.
+ */
+class ClusterAggregator
+{
+  private:
+    std::vector<int> ops;
+    double resolution = 0.01;
+    std::vector<float> lo, hi, sum;     // element-wise accumulators
+    std::vector<int32_t> bins;
+    std::vector<int64_t> quantized;
+    std::vector<int64_t> counts;
+    std::vector<uint8_t> payload;
+
+    // over the run
+    unsigned long aggregates = 0;
+    double rawBytes = 0, payloadBytes = 0;
+    double cpuTime = 0;                 // s
+
+    void encode(const float *v, unsigned int n);
+
+  public:
+    // false for an unknown operator
+    bool setOperators(const char *list);
+    void setResolution(double r) { resolution = r; }
+
+    // m members with n samples each; returns the payload size in bytes
+    unsigned int aggregate(const float *const *members, unsigned int m, unsigned int n);
+    const std::vector<uint8_t> &getPayload() const { return payload; }
+    // upper bound of aggregate() for m members with n samples each (bytes)
+    unsigned int maxPayloadBytes(unsigned int m, unsigned int n) const;
+
+    unsigned long getAggregates() const { return aggregates; }
+    double getRawBytes() const { return rawBytes; }
+    double getPayloadBytes() const { return payloadBytes; }
+    double getCPUTime() const { return cpuTime; }
+};
+
+#endif
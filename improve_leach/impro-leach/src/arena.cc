@@ -0,0 +1,62 @@
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with this program.  If not, see http://www.gnu.org/licenses/.
+//
+
+#include <algorithm>
+#include <cstdlib>
+#include <new>
+#include "arena.h"
+
+#define ARENA_CHUNK_SIZE (1 << 20) // bytes of each chunk, unless a single allocation needs more
+
+RoundArena::~RoundArena()
+{
+    for(unsigned int i = 0; i < chunks.size(); i++)
+        free(chunks[i].data);
+}
+
+void *RoundArena::allocate(size_t bytes, size_t align)
+{
+    // first chunk, from the current one, with enough room left
+    for(; current < chunks.size(); current++, used = 0){
+        size_t start = (used + align - 1) & ~(align - 1);
+        if(start + bytes <= chunks[current].size){
+            used = start + bytes;
+            return chunks[current].data + start;
+        }
+    }
+
+    Chunk c;
+    c.size = std::max<size_t>(ARENA_CHUNK_SIZE, bytes);
+    c.data = (char *) malloc(c.size);   // malloc memory is aligned for any type
+    if(!c.data) throw std::bad_alloc();
+    chunks.push_back(c);
+    current = chunks.size() - 1;
+    used = bytes;
+    return c.data;
+}
+
+size_t RoundArena::getCapacity() const
+{
+    size_t size = 0;
+    for(unsigned int i = 0; i < chunks.size(); i++)
+        size += chunks[i].size;
+    return size;
+}
+
+RoundArena &RoundArena::local()
+{
+    static thread_local RoundArena arena;
+    return arena;
+}
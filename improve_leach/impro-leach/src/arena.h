@@ -0,0 +1,74 @@
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with this program.  If not, see http://www.gnu.org/licenses/.
+//
+
+#ifndef __IMPRO_LEACH_ARENA_H_
+#define __IMPRO_LEACH_ARENA_H_
+
+#include <cstddef>
+#include <vector>
+
+/**
+ * Bump allocator for the scratch data of one round (clustering buffers).
+ *
+ * Memory is never freed individually: reset() rewinds the arena in O(1) at
+ * the start of the round and the chunks are reused, so once the largest
+ * round has been seen there are no more calls to malloc. Each thread has
+ * its own arena (local()), so parallel runs do not contend on it.
+ */
+class RoundArena
+{
+  private:
+    struct Chunk
+    {
+        char *data;
+        size_t size;
+    };
+    std::vector<Chunk> chunks;
+    size_t current = 0;     // chunk being filled
+    size_t used = 0;        // bytes used in the current chunk
+
+  public:
+    ~RoundArena();
+    void *allocate(size_t bytes, size_t align);
+    void reset() { current = 0; used = 0; }
+    size_t getCapacity() const;
+
+    static RoundArena &local();
+};
+
+/**
+ * STL allocator drawing from a RoundArena; deallocation is a no-op.
+ */
+template<class T>
+struct ArenaAllocator
+{
+    typedef T value_type;
+    RoundArena *arena;
+
+    ArenaAllocator(RoundArena &a) : arena(&a) {}
+    template<class U> ArenaAllocator(const ArenaAllocator<U> &o) : arena(o.arena) {}
+    T *allocate(size_t n) { return static_cast<T *>(arena->allocate(n * sizeof(T), alignof(T))); }
+    void deallocate(T *, size_t) {}
+};
+
+template<class T, class U>
+bool operator==(const ArenaAllocator<T> &a, const ArenaAllocator<U> &b) { return a.arena == b.arena; }
+template<class T, class U>
+bool operator!=(const ArenaAllocator<T> &a, const ArenaAllocator<U> &b) { return a.arena != b.arena; }
+
+template<class T>
+using ArenaVector = std::vector<T, ArenaAllocator<T> >;
+
+#endif
@@ -0,0 +1,79 @@
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with this program.  If not, see http://www.gnu.org/licenses/.
+//
+
+#include <algorithm>
+#include <cmath>
+#include "chindex.h"
+
+void ClusterHeadIndex::add(int r, int id, double x, double y)
+{
+    if(r != round){
+        // first CH of a new round
+        tree.clear();
+        round = r;
+    }
+    Entry e;
+    e.x = x;
+    e.y = y;
+    e.id = id;
+    tree.push_back(e);
+    built = false;
+}
+
+void ClusterHeadIndex::build(int lo, int hi, int axis)
+{
+    if(hi - lo <= 1) return;
+    int mid = (lo + hi) / 2;
+    std::nth_element(tree.begin() + lo, tree.begin() + mid, tree.begin() + hi,
+            [axis](const Entry &a, const Entry &b) { return axis ? a.y < b.y : a.x < b.x; });
+    build(lo, mid, !axis);
+    build(mid + 1, hi, !axis);
+}
+
+void ClusterHeadIndex::nearest(int lo, int hi, int axis, double x, double y, int &best, double &bestD2) const
+{
+    if(lo >= hi) return;
+    int mid = (lo + hi) / 2;
+    const Entry &e = tree[mid];
+    double dx = x - e.x, dy = y - e.y;
+    double d2 = dx*dx + dy*dy;
+    // on ties prefer the lowest id, like the first ADV received in the message-based lookup
+    if((d2 < bestD2) || (d2 == bestD2 && (best < 0 || e.id < tree[best].id))){
+        bestD2 = d2;
+        best = mid;
+    }
+
+    double diff = axis ? dy : dx;
+    int nearLo = diff < 0 ? lo : mid + 1, nearHi = diff < 0 ? mid : hi;
+    int farLo = diff < 0 ? mid + 1 : lo, farHi = diff < 0 ? hi : mid;
+    nearest(nearLo, nearHi, !axis, x, y, best, bestD2);
+    if(diff*diff <= bestD2)
+        nearest(farLo, farHi, !axis, x, y, best, bestD2);
+}
+
+int ClusterHeadIndex::nearest(int r, double x, double y, double maxDist, double &dist)
+{
+    if(r != round || tree.empty()) return -1;   // no CH elected in this round
+    if(!built){
+        build(0, tree.size(), 0);
+        built = true;
+    }
+    int best = -1;
+    double bestD2 = maxDist*maxDist;
+    nearest(0, tree.size(), 0, x, y, best, bestD2);
+    if(best < 0) return -1;
+    dist = sqrt(bestD2);
+    return tree[best].id;
+}
@@ -0,0 +1,49 @@
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with this program.  If not, see http://www.gnu.org/licenses/.
+//
+
+#ifndef __IMPRO_LEACH_CHINDEX_H_
+#define __IMPRO_LEACH_CHINDEX_H_
+
+#include <vector>
+
+/**
+ * Positions of the cluster heads elected in the current round, organized
+ * as a 2-d tree to answer "nearest CH within range" in O(log C).
+ *
+ * CHs register themselves at election time; the tree is built once, on the
+ * first query of the round, and discarded when a CH of a new round registers.
+ */
+class ClusterHeadIndex
+{
+  private:
+    struct Entry
+    {
+        double x, y;
+        int id;
+    };
+    std::vector<Entry> tree;    // implicit k-d tree: median of each range is its root
+    int round = -1;
+    bool built = false;
+
+    void build(int lo, int hi, int axis);
+    void nearest(int lo, int hi, int axis, double x, double y, int &best, double &bestD2) const;
+
+  public:
+    void add(int r, int id, double x, double y);
+    int nearest(int r, double x, double y, double maxDist, double &dist);
+    unsigned int size() const { return tree.size(); }
+};
+
+#endif
@@ -0,0 +1,133 @@
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with this program.  If not, see http://www.gnu.org/licenses/.
+//
+
+#include <algorithm>
+#include <limits>
+#include "clustering.h"
+#include "arena.h"
+
+void ClusterFormation::clear()
+{
+    ids.clear();
+    x.clear();
+    y.clear();
+    energy.clear();
+    initial.clear();
+    alreadyCH.clear();
+}
+
+void ClusterFormation::add(int id, double nx, double ny, double e, double e0, bool wasCH)
+{
+    ids.push_back(id);
+    x.push_back(nx);
+    y.push_back(ny);
+    energy.push_back(e);
+    initial.push_back(e0);
+    alreadyCH.push_back(wasCH);
+}
+
+void ClusterFormation::computeThresholds(const ElectionStrategy &election)
+{
+    th.resize(ids.size());
+    election.thresholds(energy.data(), initial.data(), alreadyCH.data(), ids.size(), th.data());
+}
+
+void ClusterFormation::elect(const double *chance)
+{
+    unsigned int n = ids.size();
+    isCH.resize(n);
+    const double *t = th.data();
+    uint8_t *ch = isCH.data();
+    for(unsigned int i = 0; i < n; i++)
+        ch[i] = chance[i] < t[i];
+}
+
+void ClusterFormation::electCentralized(unsigned int k, KMeans &kmeans)
+{
+    // LEACH-C: k clusters over the positions, each headed by the node closest
+    // to its centroid among the ones with at least the average residual energy
+    unsigned int n = ids.size();
+    isCH.assign(n, 0);
+    if(n == 0) return;
+    kmeans.run(x.data(), y.data(), n, k);
+
+    double avg = 0;
+    for(unsigned int i = 0; i < n; i++)
+        avg += energy[i];
+    avg /= n;
+    double minEnergy = avg * (1 - 1e-9); // equal batteries must not fail on rounding
+
+    ArenaVector<int> head(kmeans.getK(), -1, RoundArena::local());
+    ArenaVector<double> headD2(kmeans.getK(), 0, RoundArena::local());
+    for(unsigned int i = 0; i < n; i++){
+        if(energy[i] < minEnergy) continue;
+        int c = kmeans.getCluster(i);
+        double dx = x[i] - kmeans.getCX(c), dy = y[i] - kmeans.getCY(c);
+        double d2 = dx*dx + dy*dy;
+        if(head[c] < 0 || d2 < headD2[c]){
+            head[c] = i;
+            headD2[c] = d2;
+        }
+    }
+    // nodes of a cluster without eligible nodes will join the nearest other CH
+    for(unsigned int c = 0; c < head.size(); c++)
+        if(head[c] >= 0) isCH[head[c]] = 1;
+}
+
+void ClusterFormation::assign(int round, double maxDist)
+{
+    unsigned int n = ids.size();
+    chSlots.clear();
+    for(unsigned int i = 0; i < n; i++){
+        if(isCH[i]){
+            index.add(round, ids[i], x[i], y[i]);
+            chSlots.push_back(i);
+        }
+    }
+
+    // nearest CH of every other node
+    chOf.assign(n, -1);
+    chDist.assign(n, std::numeric_limits<double>::infinity());
+    if(!chSlots.empty()){
+        for(unsigned int i = 0; i < n; i++)
+            if(!isCH[i])
+                chOf[i] = index.nearest(round, x[i], y[i], maxDist, chDist[i]);
+    }
+
+    // group members by CH (counting sort), CH ids are mapped to their rank k
+    RoundArena &arena = RoundArena::local();
+    ArenaVector<int> rank(n ? *std::max_element(ids.begin(), ids.end()) + 1 : 0, -1, arena);
+    for(unsigned int k = 0; k < chSlots.size(); k++)
+        rank[ids[chSlots[k]]] = k;
+    memberBegin.assign(chSlots.size() + 1, 0);
+    for(unsigned int i = 0; i < n; i++)
+        if(chOf[i] >= 0) memberBegin[rank[chOf[i]] + 1]++;
+    for(unsigned int k = 0; k < chSlots.size(); k++)
+        memberBegin[k+1] += memberBegin[k];
+
+    ArenaVector<int> fill(memberBegin.begin(), memberBegin.end() - 1, arena);
+    ArenaVector<int> memberSlots(memberBegin.back(), 0, arena);
+    for(unsigned int i = 0; i < n; i++)
+        if(chOf[i] >= 0) memberSlots[fill[rank[chOf[i]]]++] = i;
+
+    // JOIN arrival order: closest first, then lowest id (all JOINs are sent at the same time)
+    memberIds.resize(memberSlots.size());
+    for(unsigned int k = 0; k < chSlots.size(); k++){
+        std::sort(memberSlots.begin() + memberBegin[k], memberSlots.begin() + memberBegin[k+1],
+                [this](int a, int b) { return chDist[a] < chDist[b] || (chDist[a] == chDist[b] && ids[a] < ids[b]); });
+        for(int m = memberBegin[k]; m < memberBegin[k+1]; m++)
+            memberIds[m] = ids[memberSlots[m]];
+    }
+}
@@ -0,0 +1,69 @@
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with this program.  If not, see http://www.gnu.org/licenses/.
+//
+
+#ifndef __IMPRO_LEACH_CLUSTERING_H_
+#define __IMPRO_LEACH_CLUSTERING_H_
+
+#include <cstdint>
+#include <vector>
+#include "chindex.h"
+#include "kmeans.h"
+#include "election.h"
+
+/**
+ * Setup phase of a LEACH round (election, nearest-CH choice and JOIN
+ * bookkeeping) computed for all the alive nodes at once.
+ *
+ * The state of the nodes is kept as structure of arrays, one slot per alive
+ * node, so that the per-node loops are independent and vectorizable.
+ * Members of each cluster are listed in the order their JOIN messages would
+ * reach the CH (by distance, then by id), which is also their TDMA turn.
+ */
+class ClusterFormation
+{
+  private:
+    // input, one slot per alive node
+    std::vector<int> ids;
+    std::vector<double> x, y, th, energy, initial;
+    std::vector<uint8_t> alreadyCH;
+    // election and assignment
+    std::vector<uint8_t> isCH;
+    std::vector<int> chOf;          // CH id of each slot (-1 for CHs and orphans)
+    std::vector<double> chDist;
+    std::vector<int> memberBegin;   // members of the k-th CH: memberIds[memberBegin[k] .. memberBegin[k+1])
+    std::vector<int> memberIds;
+    std::vector<int> chSlots;       // slot of the k-th CH
+    ClusterHeadIndex index;
+
+  public:
+    void clear();
+    void add(int id, double x, double y, double energy, double initial, bool alreadyCH);
+    void computeThresholds(const ElectionStrategy &election);
+    void elect(const double *chance);
+    void electCentralized(unsigned int k, KMeans &kmeans);
+    void assign(int round, double maxDist);
+
+    unsigned int size() const { return ids.size(); }
+    int getId(unsigned int slot) const { return ids[slot]; }
+    bool isClusterHead(unsigned int slot) const { return isCH[slot]; }
+    int getCH(unsigned int slot) const { return chOf[slot]; }
+    double getCHDist(unsigned int slot) const { return chDist[slot]; }
+    unsigned int getNumCH() const { return chSlots.size(); }
+    unsigned int getCHSlot(unsigned int k) const { return chSlots[k]; }
+    const int *getMembers(unsigned int k) const { return memberIds.data() + memberBegin[k]; }
+    unsigned int getNumMembers(unsigned int k) const { return memberBegin[k+1] - memberBegin[k]; }
+};
+
+#endif
@@ -0,0 +1,97 @@
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with this program.  If not, see http://www.gnu.org/licenses/.
+//
+
+#ifndef __IMPRO_LEACH_CODEC_H_
+#define __IMPRO_LEACH_CODEC_H_
+
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+/*
+ * Lightweight column encodings: integers as zig-zag varints of the delta
+ * with the previous value, doubles as the XOR with the previous value
+ * stored as a varint (sign and exponent of slowly changing series cancel
+ * out, so the high-order bytes are not written).
+ */
+
+inline void putVarint(std::vector<uint8_t> &out, uint64_t v)
+{
+    while(v >= 0x80){
+        out.push_back((uint8_t) (v | 0x80));
+        v >>= 7;
+    }
+    out.push_back((uint8_t) v);
+}
+
+inline uint64_t getVarint(const uint8_t *&p, const uint8_t *end)
+{
+    uint64_t v = 0;
+    for(int shift = 0; p < end && shift < 64; shift += 7){
+        uint8_t b = *p++;
+        v |= (uint64_t) (b & 0x7f) << shift;
+        if(!(b & 0x80)) break;
+    }
+    return v;
+}
+
+inline void putString(std::vector<uint8_t> &out, const char *s)
+{
+    size_t len = strlen(s);
+    putVarint(out, len);
+    out.insert(out.end(), s, s + len);
+}
+
+inline uint64_t zigzag(int64_t v) { return ((uint64_t) v << 1) ^ (uint64_t) (v >> 63); }
+inline int64_t unzigzag(uint64_t v) { return (int64_t) (v >> 1) ^ -(int64_t) (v & 1); }
+
+inline void encodeDeltaInts(std::vector<uint8_t> &out, const int64_t *v, size_t n)
+{
+    int64_t prev = 0;
+    for(size_t i = 0; i < n; i++){
+        putVarint(out, zigzag(v[i] - prev));
+        prev = v[i];
+    }
+}
+
+inline void decodeDeltaInts(const uint8_t *&p, const uint8_t *end, int64_t *v, size_t n)
+{
+    int64_t prev = 0;
+    for(size_t i = 0; i < n; i++)
+        v[i] = prev = prev + unzigzag(getVarint(p, end));
+}
+
+inline void encodeXorDoubles(std::vector<uint8_t> &out, const double *v, size_t n)
+{
+    uint64_t prev = 0;
+    for(size_t i = 0; i < n; i++){
+        uint64_t bits;
+        memcpy(&bits, &v[i], sizeof(bits));
+        putVarint(out, bits ^ prev);
+        prev = bits;
+    }
+}
+
+inline void decodeXorDoubles(const uint8_t *&p, const uint8_t *end, double *v, size_t n)
+{
+    uint64_t prev = 0;
+    for(size_t i = 0; i < n; i++){
+        uint64_t bits = getVarint(p, end) ^ prev;
+        memcpy(&v[i], &bits, sizeof(bits));
+        prev = bits;
+    }
+}
+
+#endif
@@ -0,0 +1,98 @@
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with this program.  If not, see http://www.gnu.org/licenses/.
+//
+
+#include <algorithm>
+#include <iterator>
+#include <set>
+#include <tuple>
+#include "coloring.h"
+
+void FrameColoring::clear(unsigned int vertices)
+{
+    n = vertices;
+    edges.clear();
+    numColors = 0;
+}
+
+void FrameColoring::addEdge(int a, int b)
+{
+    if(a == b) return;
+    edges.push_back(std::make_pair(std::min(a, b), std::max(a, b)));
+}
+
+void FrameColoring::color()
+{
+    // adjacency without duplicate edges
+    std::sort(edges.begin(), edges.end());
+    edges.erase(std::unique(edges.begin(), edges.end()), edges.end());
+    adjBegin.assign(n + 1, 0);
+    for(unsigned int e = 0; e < edges.size(); e++){
+        adjBegin[edges[e].first + 1]++;
+        adjBegin[edges[e].second + 1]++;
+    }
+    unsigned int maxDegree = 0;
+    for(unsigned int v = 0; v < n; v++){
+        maxDegree = std::max(maxDegree, (unsigned int) adjBegin[v+1]);
+        adjBegin[v+1] += adjBegin[v];
+    }
+    adj.resize(adjBegin[n]);
+    std::vector<int> fill(adjBegin.begin(), adjBegin.end() - 1);
+    for(unsigned int e = 0; e < edges.size(); e++){
+        adj[fill[edges[e].first]++] = edges[e].second;
+        adj[fill[edges[e].second]++] = edges[e].first;
+    }
+
+    // at most maxDegree+1 colors
+    words = (maxDegree + 1 + 63) / 64;
+    used.assign(n * words, 0);
+    colors.assign(n, -1);
+    std::vector<int> saturation(n, 0);
+
+    // (saturation, degree, -index): the last element is the next vertex
+    std::set<std::tuple<int, int, int> > queue;
+    for(unsigned int v = 0; v < n; v++)
+        queue.insert(std::make_tuple(0, adjBegin[v+1] - adjBegin[v], -(int) v));
+
+    while(!queue.empty()){
+        int v = -std::get<2>(*queue.rbegin());
+        queue.erase(std::prev(queue.end()));
+
+        // smallest color not used by the neighbors
+        const uint64_t *mask = &used[v * words];
+        int c = 0;
+        for(unsigned int w = 0; w < words; w++){
+            if(~mask[w]){
+                c = w*64 + __builtin_ctzll(~mask[w]);
+                break;
+            }
+        }
+        colors[v] = c;
+        numColors = std::max(numColors, (unsigned int) c + 1);
+
+        for(int k = adjBegin[v]; k < adjBegin[v+1]; k++){
+            int u = adj[k];
+            uint64_t &bits = used[u * words + c / 64];
+            uint64_t bit = (uint64_t) 1 << (c % 64);
+            if(colors[u] < 0 && !(bits & bit)){
+                // new color among the neighbors of u
+                int degree = adjBegin[u+1] - adjBegin[u];
+                queue.erase(std::make_tuple(saturation[u], degree, -u));
+                saturation[u]++;
+                queue.insert(std::make_tuple(saturation[u], degree, -u));
+            }
+            bits |= bit;
+        }
+    }
+}
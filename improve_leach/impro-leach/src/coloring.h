@@ -0,0 +1,54 @@
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with this program.  If not, see http://www.gnu.org/licenses/.
+//
+
+#ifndef __IMPRO_LEACH_COLORING_H_
+#define __IMPRO_LEACH_COLORING_H_
+
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+/**
+ * DSATUR coloring of the cluster adjacency graph: clusters with nodes in
+ * range of each other get different colors, i.e. different channels or
+ * TDMA frame offsets.
+ *
+ * The next vertex is the uncolored one with most distinct colors among its
+ * neighbors (saturation), then with most neighbors, then the lowest index;
+ * it gets the smallest color not used by its neighbors.
+ */
+class FrameColoring
+{
+  private:
+    unsigned int n = 0;
+    std::vector<std::pair<int, int> > edges;
+    std::vector<int> adjBegin, adj;     // CSR of the edges, both directions
+    std::vector<int> colors;
+    std::vector<uint64_t> used;         // colors of the neighbors, a bit mask per vertex
+    unsigned int words = 0;             // mask words per vertex
+    unsigned int numColors = 0;
+
+  public:
+    void clear(unsigned int vertices);
+    void addEdge(int a, int b);
+    void color();
+
+    unsigned int size() const { return n; }
+    int getColor(int v) const { return colors[v]; }
+    unsigned int getNumColors() const { return numColors; }
+    unsigned int getNumEdges() const { return adj.size() / 2; }
+};
+
+#endif
@@ -0,0 +1,323 @@
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with this program.  If not, see http://www.gnu.org/licenses/.
+//
+
+#include <cstdlib>
+#include "columnar.h"
+#include "codec.h"
+
+#define COLUMNAR_MAGIC "LEACHCOL"
+#define COLUMNAR_VERSION 1
+#define MAX_PENDING 8   // chunks waiting for the writer before the simulation blocks
+
+Register_PerRunConfigOption(CFGID_COLUMNAR_FILE, "columnar-file", CFG_FILENAME, "${resultdir}/${configname}-${iterationvarsf}#${repetition}.col", "Output file of ColumnarOutputVectorManager and ColumnarOutputScalarManager.");
+
+Register_Class(ColumnarOutputVectorManager);
+Register_Class(ColumnarOutputScalarManager);
+
+static std::string configuredFileName()
+{
+    return getEnvir()->getConfig()->getAsFilename(CFGID_COLUMNAR_FILE);
+}
+
+static std::string currentRunId()
+{
+    return getEnvir()->getConfigEx()->getVariable("runid");
+}
+
+// per-object vector-recording / scalar-recording, as the stock managers do
+static bool recordingEnabled(const std::string &objectPath, bool vector)
+{
+    static cConfigOption *vectorRecording = cConfigOption::find("vector-recording");
+    static cConfigOption *scalarRecording = cConfigOption::find("scalar-recording");
+    cConfigOption *o = vector ? vectorRecording : scalarRecording;
+    return !o || getEnvir()->getConfig()->getAsBool(objectPath.c_str(), o, true);
+}
+
+/********* Store **********/
+ColumnarStore *ColumnarStore::getInstance()
+{
+    static ColumnarStore store;
+    return &store;
+}
+
+int ColumnarStore::moduleIndexOf(const char *modulePath)
+{
+    // "Base_net.node[12]" -> 12, -1 for modules that are not in a vector
+    size_t len = strlen(modulePath);
+    if(len < 3 || modulePath[len-1] != ']') return -1;
+    const char *open = strrchr(modulePath, '[');
+    return open ? atoi(open + 1) : -1;
+}
+
+void ColumnarStore::startRun(const std::string &fileName, const std::string &runId)
+{
+    if(users++ > 0) return;   // the other manager has already opened the run
+
+    f = fopen(fileName.c_str(), "ab");
+    if(!f)
+        throw cRuntimeError("Cannot open columnar result file '%s'", fileName.c_str());
+    fseek(f, 0, SEEK_END); // the position after opening for append is not the end everywhere
+    if(ftell(f) == 0){
+        uint32_t version = COLUMNAR_VERSION;
+        fwrite(COLUMNAR_MAGIC, 8, 1, f);
+        fwrite(&version, sizeof(version), 1, f);
+    }
+    nextVectorId = 0;
+    stopping = false;
+    writer = std::thread(&ColumnarStore::writerLoop, this);
+
+    Pending run;
+    run.type = 'R';
+    putString(run.payload, runId.c_str());
+    enqueue(std::move(run));
+}
+
+void ColumnarStore::endRun()
+{
+    if(users == 0 || --users > 0) return;
+
+    flush();
+    {
+        std::lock_guard<std::mutex> guard(lock);
+        stopping = true;
+    }
+    changed.notify_all();
+    writer.join();
+    fclose(f);
+    f = nullptr;
+}
+
+unsigned int ColumnarStore::declareVector(const char *module, const char *name, int moduleIndex)
+{
+    Pending decl;
+    decl.type = 'V';
+    unsigned int id = nextVectorId++;
+    putVarint(decl.payload, id);
+    putString(decl.payload, module);
+    putString(decl.payload, name);
+    putVarint(decl.payload, zigzag(moduleIndex));
+    enqueue(std::move(decl));
+    return id;
+}
+
+void ColumnarStore::record(unsigned int vectorId, int moduleIndex, int round, double t, double value)
+{
+    current.vectorId.push_back(vectorId);
+    current.moduleIndex.push_back(moduleIndex);
+    current.round.push_back(round);
+    current.time.push_back(t);
+    current.value.push_back(value);
+    if(current.size() >= chunkRows)
+        flush();
+}
+
+void ColumnarStore::recordScalar(const char *module, const char *name, double value)
+{
+    Pending scalar;
+    scalar.type = 'S';
+    putString(scalar.payload, module);
+    putString(scalar.payload, name);
+    putVarint(scalar.payload, zigzag(moduleIndexOf(module)));
+    const uint8_t *raw = (const uint8_t *) &value;
+    scalar.payload.insert(scalar.payload.end(), raw, raw + sizeof(value));
+    enqueue(std::move(scalar));
+}
+
+void ColumnarStore::flush()
+{
+    if(!f || current.size() == 0) return;
+    Pending chunk;
+    chunk.type = 'C';
+    std::swap(chunk.chunk, current);
+    enqueue(std::move(chunk));
+}
+
+void ColumnarStore::enqueue(Pending &&p)
+{
+    std::unique_lock<std::mutex> guard(lock);
+    // do not let the simulation run arbitrarily ahead of the disk
+    changed.wait(guard, [this]() { return queue.size() < MAX_PENDING; });
+    queue.push_back(std::move(p));
+    guard.unlock();
+    changed.notify_all();
+}
+
+void ColumnarStore::writerLoop()
+{
+    std::vector<uint8_t> encoded;
+    while(true){
+        Pending p;
+        {
+            std::unique_lock<std::mutex> guard(lock);
+            changed.wait(guard, [this]() { return stopping || !queue.empty(); });
+            if(queue.empty()) break;   // stopping, and everything has been written
+            p = std::move(queue.front());
+            queue.pop_front();
+        }
+        changed.notify_all();
+
+        if(p.type == 'C'){
+            encoded.clear();
+            encodeChunk(p.chunk, encoded);
+            writeRecord('C', encoded);
+        }
+        else
+            writeRecord(p.type, p.payload);
+    }
+    fflush(f);
+}
+
+void ColumnarStore::writeRecord(char type, const std::vector<uint8_t> &payload)
+{
+    std::vector<uint8_t> header;
+    header.push_back(type);
+    putVarint(header, payload.size());
+    fwrite(header.data(), 1, header.size(), f);
+    fwrite(payload.data(), 1, payload.size(), f);
+}
+
+void ColumnarStore::encodeChunk(const Chunk &c, std::vector<uint8_t> &out)
+{
+    size_t n = c.size();
+    putVarint(out, n);
+    std::vector<uint8_t> column;
+    for(int col = 0; col < 5; col++){
+        column.clear();
+        switch(col){
+            case 0: encodeDeltaInts(column, c.vectorId.data(), n); break;
+            case 1: encodeDeltaInts(column, c.moduleIndex.data(), n); break;
+            case 2: encodeDeltaInts(column, c.round.data(), n); break;
+            case 3: encodeXorDoubles(column, c.time.data(), n); break;
+            case 4: encodeXorDoubles(column, c.value.data(), n); break;
+        }
+        putVarint(out, column.size());
+        out.insert(out.end(), column.begin(), column.end());
+    }
+}
+
+/********* Vector manager **********/
+void ColumnarOutputVectorManager::startRun()
+{
+    fileName = configuredFileName();
+    roundPar = nullptr;
+    ColumnarStore::getInstance()->startRun(fileName, currentRunId());
+}
+
+void ColumnarOutputVectorManager::endRun()
+{
+    roundPar = nullptr;
+    ColumnarStore::getInstance()->endRun();
+}
+
+void *ColumnarOutputVectorManager::registerVector(const char *modulename, const char *vectorname)
+{
+    Handle *h = new Handle();
+    h->module = modulename;
+    h->name = vectorname;
+    h->moduleIndex = ColumnarStore::moduleIndexOf(modulename);
+    h->enabled = recordingEnabled(h->module + "." + h->name, true);
+    return h;
+}
+
+void ColumnarOutputVectorManager::deregisterVector(void *vechandle)
+{
+    delete (Handle *) vechandle;
+}
+
+void ColumnarOutputVectorManager::setVectorAttribute(void *vechandle, const char *name, const char *value)
+{
+    // attributes (title, interpolation mode, ...) are not stored
+}
+
+bool ColumnarOutputVectorManager::record(void *vechandle, simtime_t t, double value)
+{
+    Handle *h = (Handle *) vechandle;
+    if(!h->enabled) return false;
+    ColumnarStore *store = ColumnarStore::getInstance();
+    if(h->id < 0)
+        h->id = store->declareVector(h->module.c_str(), h->name.c_str(), h->moduleIndex);
+
+    if(!roundPar){
+        cModule *network = getSimulation()->getSystemModule();
+        if(network && network->hasPar("round"))
+            roundPar = &network->par("round");
+    }
+    int round = roundPar ? (int) roundPar->intValue() : -1;
+
+    store->record(h->id, h->moduleIndex, round, t.dbl(), value);
+    return true;
+}
+
+const char *ColumnarOutputVectorManager::getFileName() const
+{
+    return fileName.c_str();
+}
+
+void ColumnarOutputVectorManager::flush()
+{
+    ColumnarStore::getInstance()->flush();
+}
+
+/********* Scalar manager **********/
+void ColumnarOutputScalarManager::startRun()
+{
+    fileName = configuredFileName();
+    ColumnarStore::getInstance()->startRun(fileName, currentRunId());
+}
+
+void ColumnarOutputScalarManager::endRun()
+{
+    ColumnarStore::getInstance()->endRun();
+}
+
+void ColumnarOutputScalarManager::recordScalar(cComponent *component, const char *name, double value, opp_string_map *attributes)
+{
+    std::string module = component->getFullPath();
+    if(!recordingEnabled(module + "." + name, false)) return;
+    ColumnarStore::getInstance()->recordScalar(module.c_str(), name, value);
+}
+
+void ColumnarOutputScalarManager::recordStatistic(cComponent *component, const char *name, cStatistic *statistic, opp_string_map *attributes)
+{
+    // summary fields only, as name:field scalars
+    std::string module = component->getFullPath();
+    std::string prefix = std::string(name ? name : statistic->getName()) + ":";
+    if(!recordingEnabled(module + "." + (name ? name : statistic->getName()), false)) return;
+    ColumnarStore *store = ColumnarStore::getInstance();
+    store->recordScalar(module.c_str(), (prefix + "count").c_str(), statistic->getCount());
+    store->recordScalar(module.c_str(), (prefix + "mean").c_str(), statistic->getMean());
+    store->recordScalar(module.c_str(), (prefix + "stddev").c_str(), statistic->getStddev());
+    store->recordScalar(module.c_str(), (prefix + "min").c_str(), statistic->getMin());
+    store->recordScalar(module.c_str(), (prefix + "max").c_str(), statistic->getMax());
+}
+
+void ColumnarOutputScalarManager::recordParameter(cPar *par)
+{
+    // parameters are already in the ini file
+}
+
+void ColumnarOutputScalarManager::recordComponentType(cComponent *component)
+{
+}
+
+const char *ColumnarOutputScalarManager::getFileName() const
+{
+    return fileName.c_str();
+}
+
+void ColumnarOutputScalarManager::flush()
+{
+    ColumnarStore::getInstance()->flush();
+}
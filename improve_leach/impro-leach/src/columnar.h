@@ -0,0 +1,134 @@
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with this program.  If not, see http://www.gnu.org/licenses/.
+//
+
+#ifndef __IMPRO_LEACH_COLUMNAR_H_
+#define __IMPRO_LEACH_COLUMNAR_H_
+
+#include <condition_variable>
+#include <cstdio>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include <omnetpp.h>
+
+using namespace omnetpp;
+
+/**
+ * Binary result file shared by the columnar vector and scalar managers.
+ *
+ * The file is a sequence of records (type byte, varint length, payload):
+ *  'R' run id; 'V' vector declaration (id, module, name, module index);
+ *  'C' chunk of vector samples stored column by column (vector id, module
+ *      index, round, time, value, see codec.h for the encodings);
+ *  'S' scalar (module, name, module index, raw double).
+ * Samples are buffered into chunks by the simulation thread; encoding and
+ * file writes happen in a background thread.
+ */
+class ColumnarStore
+{
+  private:
+    struct Chunk
+    {
+        std::vector<int64_t> vectorId, moduleIndex, round;
+        std::vector<double> time, value;
+        size_t size() const { return time.size(); }
+    };
+    struct Pending
+    {
+        char type;
+        std::vector<uint8_t> payload;  // ready to write, unless type is 'C'
+        Chunk chunk;
+    };
+
+    FILE *f = nullptr;
+    int users = 0;              // managers that started the current run
+    unsigned int nextVectorId = 0;
+    Chunk current;
+    size_t chunkRows = 65536;
+
+    std::thread writer;
+    std::mutex lock;
+    std::condition_variable changed;
+    std::deque<Pending> queue;
+    bool stopping = false;
+
+    void enqueue(Pending &&p);
+    void writerLoop();
+    void writeRecord(char type, const std::vector<uint8_t> &payload);
+    static void encodeChunk(const Chunk &c, std::vector<uint8_t> &out);
+
+  public:
+    static ColumnarStore *getInstance();
+    static int moduleIndexOf(const char *modulePath);
+
+    void startRun(const std::string &fileName, const std::string &runId);
+    void endRun();
+    unsigned int declareVector(const char *module, const char *name, int moduleIndex);
+    void record(unsigned int vectorId, int moduleIndex, int round, double t, double value);
+    void recordScalar(const char *module, const char *name, double value);
+    void flush();
+};
+
+/**
+ * Output vector manager writing to the columnar store.
+ * Select it with outputvectormanager-class = "ColumnarOutputVectorManager".
+ */
+class ColumnarOutputVectorManager : public cIOutputVectorManager
+{
+  private:
+    struct Handle
+    {
+        std::string module, name;
+        int moduleIndex;
+        bool enabled = true;    // vector-recording of the vector
+        int id = -1;            // declared lazily, on the first sample
+    };
+    std::string fileName;
+    cPar *roundPar = nullptr;   // Base_net.round, if the network has it
+
+  public:
+    virtual void startRun() override;
+    virtual void endRun() override;
+    virtual void *registerVector(const char *modulename, const char *vectorname) override;
+    virtual void deregisterVector(void *vechandle) override;
+    virtual void setVectorAttribute(void *vechandle, const char *name, const char *value) override;
+    virtual bool record(void *vechandle, simtime_t t, double value) override;
+    virtual const char *getFileName() const override;
+    virtual void flush() override;
+};
+
+/**
+ * Output scalar manager writing to the columnar store.
+ * Select it with outputscalarmanager-class = "ColumnarOutputScalarManager".
+ */
+class ColumnarOutputScalarManager : public cIOutputScalarManager
+{
+  private:
+    std::string fileName;
+
+  public:
+    virtual void startRun() override;
+    virtual void endRun() override;
+    virtual void recordScalar(cComponent *component, const char *name, double value, opp_string_map *attributes=nullptr) override;
+    virtual void recordStatistic(cComponent *component, const char *name, cStatistic *statistic, opp_string_map *attributes=nullptr) override;
+    virtual void recordParameter(cPar *par) override;
+    virtual void recordComponentType(cComponent *component) override;
+    virtual const char *getFileName() const override;
+    virtual void flush() override;
+};
+
+#endif
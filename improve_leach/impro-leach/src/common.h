@@ -18,18 +18,56 @@
 #define SCHED_M_SIZE 128+64 // size of
 #define DATA_M_SIZE 2000 // size of DATA message (bit)
 #define COMP_FACTOR 10.0
+#define AGGR_HEADER_SIZE 128 // size of an aggregate with real payload, without the payload (bit)
 
 #define MAX_DIST(range) (range)
 //#define BS_DIST(x,y) (sqrt(pow(((100) - x),2) + pow(((-100) - y),2)))
 #define BS_DIST(x,y) (sqrt(pow((x),2) + pow((y),2)))
 
-//#define CH_SLOT_MAXDIST_IN_CLUSTER // <-- enable almost adaptive TDMA. if not, TDMA slots are the same for all the network
-//#define USE_BS_DIST // <-- use the real distance from BS instead of MAX_DIST
-//#define ACCOUNT_CH_SETUP
-#define ONE_TX_PER_ROUND
-
 #define BS_ID 999999
 
+/**
+ * Protocol variants, selected by the Base_net parameters of the same name.
+ * Every combination is compiled; PolicySelect picks one in initialize() and
+ * the code of each combination has no run-time checks of the switches.
+ */
+template<bool SlotMaxDistInCluster, bool UseBSDist, bool AccountCHSetup, bool OneTxPerRound>
+struct LeachPolicy
+{
+    static const bool slotMaxDistInCluster = SlotMaxDistInCluster; // <-- almost adaptive TDMA. if not, TDMA slots are the same for all the network
+    static const bool useBSDist = UseBSDist;            // <-- use the real distance from BS instead of MAX_DIST
+    static const bool accountCHSetup = AccountCHSetup;  // <-- account the energy of the setup phase (ADV, JOIN, SCHED, idle listening)
+    static const bool oneTxPerRound = OneTxPerRound;    // <-- one DATA transmission per node and round
+};
+
+// F::get<LeachPolicy<...>>() for the flags given at run time (in LeachPolicy order)
+template<class F, int K, bool... B>
+struct PolicySelect
+{
+    static typename F::type get(const bool *flags)
+    {
+        return flags[0] ? PolicySelect<F, K-1, B..., true>::get(flags+1) : PolicySelect<F, K-1, B..., false>::get(flags+1);
+    }
+};
+
+template<class F, bool... B>
+struct PolicySelect<F, 0, B...>
+{
+    static typename F::type get(const bool *flags)
+    {
+        return F::template get<LeachPolicy<B...> >();
+    }
+};
+
+
+// LEACH threshold T(n) of a node in round r
+inline double leachThreshold(double P, int r, bool alreadyCH)
+{
+    if(!alreadyCH)
+        return P/(1-P*(r % 1/P));
+    else
+        return 0;
+}
 
 enum msgKinds {
     // LEACH protocol messages
@@ -45,13 +83,24 @@ enum msgKinds {
     RCVD_SCHED,
     RCVD_DATA,
     // new events
-    CENTER_M
+    CENTER_M,
+    FORK_SNAPSHOT,
+    WARM_RESTART,
+    AGGREGATE_M,    // CH aggregate to the BS
+    ORPHAN_WINDOW   // BS: no more orphan JOINs this round
 };
 
 enum compState {
     RX,
     TX,
-    COMPRESS
+    COMPRESS,
+    RADIO       // radio states since the last change (see RadioState)
+};
+
+enum chLookupMode {
+    LOOKUP_ADV,         // scan the received ADV messages
+    LOOKUP_INDEX,       // query the CH index, no ADV is sent
+    LOOKUP_VALIDATE     // both, and check that they agree
 };
 
 enum nodeRole {
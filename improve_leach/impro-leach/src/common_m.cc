@@ -463,6 +463,7 @@ mData::mData(const char *name, short kind) : ::omnetpp::cMessage(name,kind)
 {
     this->id = 0;
     this->round = 0;
+    this->created = 0;
 }
 
 mData::mData(const mData& other) : ::omnetpp::cMessage(other)
@@ -486,6 +487,8 @@ void mData::copy(const mData& other)
 {
     this->id = other.id;
     this->round = other.round;
+    this->created = other.created;
+    this->samples = other.samples;
 }
 
 void mData::parsimPack(omnetpp::cCommBuffer *b) const
@@ -493,6 +496,8 @@ void mData::parsimPack(omnetpp::cCommBuffer *b) const
     ::omnetpp::cMessage::parsimPack(b);
     doParsimPacking(b,this->id);
     doParsimPacking(b,this->round);
+    doParsimPacking(b,this->created);
+    doParsimPacking(b,this->samples);
 }
 
 void mData::parsimUnpack(omnetpp::cCommBuffer *b)
@@ -500,6 +505,8 @@ void mData::parsimUnpack(omnetpp::cCommBuffer *b)
     ::omnetpp::cMessage::parsimUnpack(b);
     doParsimUnpacking(b,this->id);
     doParsimUnpacking(b,this->round);
+    doParsimUnpacking(b,this->created);
+    doParsimUnpacking(b,this->samples);
 }
 
 int mData::getId() const
@@ -522,6 +529,26 @@ void mData::setRound(int round)
     this->round = round;
 }
 
+::omnetpp::simtime_t mData::getCreated() const
+{
+    return this->created;
+}
+
+void mData::setCreated(::omnetpp::simtime_t created)
+{
+    this->created = created;
+}
+
+SampleVector& mData::getSamples()
+{
+    return this->samples;
+}
+
+void mData::setSamples(const SampleVector& samples)
+{
+    this->samples = samples;
+}
+
 class mDataDescriptor : public omnetpp::cClassDescriptor
 {
   private:
@@ -587,7 +614,7 @@ const char *mDataDescriptor::getProperty(const char *propertyname) const
 int mDataDescriptor::getFieldCount() const
 {
     omnetpp::cClassDescriptor *basedesc = getBaseClassDescriptor();
-    return basedesc ? 2+basedesc->getFieldCount() : 2;
+    return basedesc ? 4+basedesc->getFieldCount() : 4;
 }
 
 unsigned int mDataDescriptor::getFieldTypeFlags(int field) const
@@ -601,8 +628,10 @@ unsigned int mDataDescriptor::getFieldTypeFlags(int field) const
     static unsigned int fieldTypeFlags[] = {
         FD_ISEDITABLE,
         FD_ISEDITABLE,
+        FD_ISEDITABLE,
+        FD_ISCOMPOUND,
     };
-    return (field>=0 && field<2) ? fieldTypeFlags[field] : 0;
+    return (field>=0 && field<4) ? fieldTypeFlags[field] : 0;
 }
 
 const char *mDataDescriptor::getFieldName(int field) const
@@ -616,8 +645,10 @@ const char *mDataDescriptor::getFieldName(int field) const
     static const char *fieldNames[] = {
         "id",
         "round",
+        "created",
+        "samples",
     };
-    return (field>=0 && field<2) ? fieldNames[field] : nullptr;
+    return (field>=0 && field<4) ? fieldNames[field] : nullptr;
 }
 
 int mDataDescriptor::findField(const char *fieldName) const
@@ -626,6 +657,8 @@ int mDataDescriptor::findField(const char *fieldName) const
     int base = basedesc ? basedesc->getFieldCount() : 0;
     if (fieldName[0]=='i' && strcmp(fieldName, "id")==0) return base+0;
     if (fieldName[0]=='r' && strcmp(fieldName, "round")==0) return base+1;
+    if (fieldName[0]=='c' && strcmp(fieldName, "created")==0) return base+2;
+    if (fieldName[0]=='s' && strcmp(fieldName, "samples")==0) return base+3;
     return basedesc ? basedesc->findField(fieldName) : -1;
 }
 
@@ -640,8 +673,10 @@ const char *mDataDescriptor::getFieldTypeString(int field) const
     static const char *fieldTypeStrings[] = {
         "int",
         "int",
+        "simtime_t",
+        "SampleVector",
     };
-    return (field>=0 && field<2) ? fieldTypeStrings[field] : nullptr;
+    return (field>=0 && field<4) ? fieldTypeStrings[field] : nullptr;
 }
 
 const char **mDataDescriptor::getFieldPropertyNames(int field) const
@@ -710,6 +745,8 @@ std::string mDataDescriptor::getFieldValueAsString(void *object, int field, int
     switch (field) {
         case 0: return long2string(pp->getId());
         case 1: return long2string(pp->getRound());
+        case 2: return simtime2string(pp->getCreated());
+        case 3: {std::stringstream out; out << pp->getSamples(); return out.str();}
         default: return "";
     }
 }
@@ -726,6 +763,7 @@ bool mDataDescriptor::setFieldValueAsString(void *object, int field, int i, cons
     switch (field) {
         case 0: pp->setId(string2long(value)); return true;
         case 1: pp->setRound(string2long(value)); return true;
+        case 2: pp->setCreated(string2simtime(value)); return true;
         default: return false;
     }
 }
@@ -739,6 +777,7 @@ const char *mDataDescriptor::getFieldStructName(int field) const
         field -= basedesc->getFieldCount();
     }
     switch (field) {
+        case 3: return omnetpp::opp_typename(typeid(SampleVector));
         default: return nullptr;
     };
 }
@@ -753,6 +792,7 @@ void *mDataDescriptor::getFieldStructValuePointer(void *object, int field, int i
     }
     mData *pp = (mData *)object; (void)pp;
     switch (field) {
+        case 3: return (void *)(&pp->getSamples()); break;
         default: return nullptr;
     }
 }
@@ -1697,4 +1737,384 @@ void *mCenterCHDescriptor::getFieldStructValuePointer(void *object, int field, i
     }
 }
 
+Register_Class(mAggregate)
+
+mAggregate::mAggregate(const char *name, short kind) : ::omnetpp::cMessage(name,kind)
+{
+    this->id = 0;
+    this->round = 0;
+    this->count = 0;
+    this->oldest = 0;
+    this->newest = 0;
+}
+
+mAggregate::mAggregate(const mAggregate& other) : ::omnetpp::cMessage(other)
+{
+    copy(other);
+}
+
+mAggregate::~mAggregate()
+{
+}
+
+mAggregate& mAggregate::operator=(const mAggregate& other)
+{
+    if (this==&other) return *this;
+    ::omnetpp::cMessage::operator=(other);
+    copy(other);
+    return *this;
+}
+
+void mAggregate::copy(const mAggregate& other)
+{
+    this->id = other.id;
+    this->round = other.round;
+    this->count = other.count;
+    this->oldest = other.oldest;
+    this->newest = other.newest;
+    this->payload = other.payload;
+}
+
+void mAggregate::parsimPack(omnetpp::cCommBuffer *b) const
+{
+    ::omnetpp::cMessage::parsimPack(b);
+    doParsimPacking(b,this->id);
+    doParsimPacking(b,this->round);
+    doParsimPacking(b,this->count);
+    doParsimPacking(b,this->oldest);
+    doParsimPacking(b,this->newest);
+    doParsimPacking(b,this->payload);
+}
+
+void mAggregate::parsimUnpack(omnetpp::cCommBuffer *b)
+{
+    ::omnetpp::cMessage::parsimUnpack(b);
+    doParsimUnpacking(b,this->id);
+    doParsimUnpacking(b,this->round);
+    doParsimUnpacking(b,this->count);
+    doParsimUnpacking(b,this->oldest);
+    doParsimUnpacking(b,this->newest);
+    doParsimUnpacking(b,this->payload);
+}
+
+int mAggregate::getId() const
+{
+    return this->id;
+}
+
+void mAggregate::setId(int id)
+{
+    this->id = id;
+}
+
+int mAggregate::getRound() const
+{
+    return this->round;
+}
+
+void mAggregate::setRound(int round)
+{
+    this->round = round;
+}
+
+int mAggregate::getCount() const
+{
+    return this->count;
+}
+
+void mAggregate::setCount(int count)
+{
+    this->count = count;
+}
+
+::omnetpp::simtime_t mAggregate::getOldest() const
+{
+    return this->oldest;
+}
+
+void mAggregate::setOldest(::omnetpp::simtime_t oldest)
+{
+    this->oldest = oldest;
+}
+
+::omnetpp::simtime_t mAggregate::getNewest() const
+{
+    return this->newest;
+}
+
+void mAggregate::setNewest(::omnetpp::simtime_t newest)
+{
+    this->newest = newest;
+}
+
+PayloadBytes& mAggregate::getPayload()
+{
+    return this->payload;
+}
+
+void mAggregate::setPayload(const PayloadBytes& payload)
+{
+    this->payload = payload;
+}
+
+class mAggregateDescriptor : public omnetpp::cClassDescriptor
+{
+  private:
+    mutable const char **propertynames;
+  public:
+    mAggregateDescriptor();
+    virtual ~mAggregateDescriptor();
+
+    virtual bool doesSupport(omnetpp::cObject *obj) const override;
+    virtual const char **getPropertyNames() const override;
+    virtual const char *getProperty(const char *propertyname) const override;
+    virtual int getFieldCount() const override;
+    virtual const char *getFieldName(int field) const override;
+    virtual int findField(const char *fieldName) const override;
+    virtual unsigned int getFieldTypeFlags(int field) const override;
+    virtual const char *getFieldTypeString(int field) const override;
+    virtual const char **getFieldPropertyNames(int field) const override;
+    virtual const char *getFieldProperty(int field, const char *propertyname) const override;
+    virtual int getFieldArraySize(void *object, int field) const override;
+
+    virtual const char *getFieldDynamicTypeString(void *object, int field, int i) const override;
+    virtual std::string getFieldValueAsString(void *object, int field, int i) const override;
+    virtual bool setFieldValueAsString(void *object, int field, int i, const char *value) const override;
+
+    virtual const char *getFieldStructName(int field) const override;
+    virtual void *getFieldStructValuePointer(void *object, int field, int i) const override;
+};
+
+Register_ClassDescriptor(mAggregateDescriptor)
+
+mAggregateDescriptor::mAggregateDescriptor() : omnetpp::cClassDescriptor("mAggregate", "omnetpp::cMessage")
+{
+    propertynames = nullptr;
+}
+
+mAggregateDescriptor::~mAggregateDescriptor()
+{
+    delete[] propertynames;
+}
+
+bool mAggregateDescriptor::doesSupport(omnetpp::cObject *obj) const
+{
+    return dynamic_cast<mAggregate *>(obj)!=nullptr;
+}
+
+const char **mAggregateDescriptor::getPropertyNames() const
+{
+    if (!propertynames) {
+        static const char *names[] = {  nullptr };
+        omnetpp::cClassDescriptor *basedesc = getBaseClassDescriptor();
+        const char **basenames = basedesc ? basedesc->getPropertyNames() : nullptr;
+        propertynames = mergeLists(basenames, names);
+    }
+    return propertynames;
+}
+
+const char *mAggregateDescriptor::getProperty(const char *propertyname) const
+{
+    omnetpp::cClassDescriptor *basedesc = getBaseClassDescriptor();
+    return basedesc ? basedesc->getProperty(propertyname) : nullptr;
+}
+
+int mAggregateDescriptor::getFieldCount() const
+{
+    omnetpp::cClassDescriptor *basedesc = getBaseClassDescriptor();
+    return basedesc ? 6+basedesc->getFieldCount() : 6;
+}
+
+unsigned int mAggregateDescriptor::getFieldTypeFlags(int field) const
+{
+    omnetpp::cClassDescriptor *basedesc = getBaseClassDescriptor();
+    if (basedesc) {
+        if (field < basedesc->getFieldCount())
+            return basedesc->getFieldTypeFlags(field);
+        field -= basedesc->getFieldCount();
+    }
+    static unsigned int fieldTypeFlags[] = {
+        FD_ISEDITABLE,
+        FD_ISEDITABLE,
+        FD_ISEDITABLE,
+        FD_ISEDITABLE,
+        FD_ISEDITABLE,
+        FD_ISCOMPOUND,
+    };
+    return (field>=0 && field<6) ? fieldTypeFlags[field] : 0;
+}
+
+const char *mAggregateDescriptor::getFieldName(int field) const
+{
+    omnetpp::cClassDescriptor *basedesc = getBaseClassDescriptor();
+    if (basedesc) {
+        if (field < basedesc->getFieldCount())
+            return basedesc->getFieldName(field);
+        field -= basedesc->getFieldCount();
+    }
+    static const char *fieldNames[] = {
+        "id",
+        "round",
+        "count",
+        "oldest",
+        "newest",
+        "payload",
+    };
+    return (field>=0 && field<6) ? fieldNames[field] : nullptr;
+}
+
+int mAggregateDescriptor::findField(const char *fieldName) const
+{
+    omnetpp::cClassDescriptor *basedesc = getBaseClassDescriptor();
+    int base = basedesc ? basedesc->getFieldCount() : 0;
+    if (fieldName[0]=='i' && strcmp(fieldName, "id")==0) return base+0;
+    if (fieldName[0]=='r' && strcmp(fieldName, "round")==0) return base+1;
+    if (fieldName[0]=='c' && strcmp(fieldName, "count")==0) return base+2;
+    if (fieldName[0]=='o' && strcmp(fieldName, "oldest")==0) return base+3;
+    if (fieldName[0]=='n' && strcmp(fieldName, "newest")==0) return base+4;
+    if (fieldName[0]=='p' && strcmp(fieldName, "payload")==0) return base+5;
+    return basedesc ? basedesc->findField(fieldName) : -1;
+}
+
+const char *mAggregateDescriptor::getFieldTypeString(int field) const
+{
+    omnetpp::cClassDescriptor *basedesc = getBaseClassDescriptor();
+    if (basedesc) {
+        if (field < basedesc->getFieldCount())
+            return basedesc->getFieldTypeString(field);
+        field -= basedesc->getFieldCount();
+    }
+    static const char *fieldTypeStrings[] = {
+        "int",
+        "int",
+        "int",
+        "simtime_t",
+        "simtime_t",
+        "PayloadBytes",
+    };
+    return (field>=0 && field<6) ? fieldTypeStrings[field] : nullptr;
+}
+
+const char **mAggregateDescriptor::getFieldPropertyNames(int field) const
+{
+    omnetpp::cClassDescriptor *basedesc = getBaseClassDescriptor();
+    if (basedesc) {
+        if (field < basedesc->getFieldCount())
+            return basedesc->getFieldPropertyNames(field);
+        field -= basedesc->getFieldCount();
+    }
+    switch (field) {
+        default: return nullptr;
+    }
+}
+
+const char *mAggregateDescriptor::getFieldProperty(int field, const char *propertyname) const
+{
+    omnetpp::cClassDescriptor *basedesc = getBaseClassDescriptor();
+    if (basedesc) {
+        if (field < basedesc->getFieldCount())
+            return basedesc->getFieldProperty(field, propertyname);
+        field -= basedesc->getFieldCount();
+    }
+    switch (field) {
+        default: return nullptr;
+    }
+}
+
+int mAggregateDescriptor::getFieldArraySize(void *object, int field) const
+{
+    omnetpp::cClassDescriptor *basedesc = getBaseClassDescriptor();
+    if (basedesc) {
+        if (field < basedesc->getFieldCount())
+            return basedesc->getFieldArraySize(object, field);
+        field -= basedesc->getFieldCount();
+    }
+    mAggregate *pp = (mAggregate *)object; (void)pp;
+    switch (field) {
+        default: return 0;
+    }
+}
+
+const char *mAggregateDescriptor::getFieldDynamicTypeString(void *object, int field, int i) const
+{
+    omnetpp::cClassDescriptor *basedesc = getBaseClassDescriptor();
+    if (basedesc) {
+        if (field < basedesc->getFieldCount())
+            return basedesc->getFieldDynamicTypeString(object,field,i);
+        field -= basedesc->getFieldCount();
+    }
+    mAggregate *pp = (mAggregate *)object; (void)pp;
+    switch (field) {
+        default: return nullptr;
+    }
+}
+
+std::string mAggregateDescriptor::getFieldValueAsString(void *object, int field, int i) const
+{
+    omnetpp::cClassDescriptor *basedesc = getBaseClassDescriptor();
+    if (basedesc) {
+        if (field < basedesc->getFieldCount())
+            return basedesc->getFieldValueAsString(object,field,i);
+        field -= basedesc->getFieldCount();
+    }
+    mAggregate *pp = (mAggregate *)object; (void)pp;
+    switch (field) {
+        case 0: return long2string(pp->getId());
+        case 1: return long2string(pp->getRound());
+        case 2: return long2string(pp->getCount());
+        case 3: return simtime2string(pp->getOldest());
+        case 4: return simtime2string(pp->getNewest());
+        case 5: {std::stringstream out; out << pp->getPayload(); return out.str();}
+        default: return "";
+    }
+}
+
+bool mAggregateDescriptor::setFieldValueAsString(void *object, int field, int i, const char *value) const
+{
+    omnetpp::cClassDescriptor *basedesc = getBaseClassDescriptor();
+    if (basedesc) {
+        if (field < basedesc->getFieldCount())
+            return basedesc->setFieldValueAsString(object,field,i,value);
+        field -= basedesc->getFieldCount();
+    }
+    mAggregate *pp = (mAggregate *)object; (void)pp;
+    switch (field) {
+        case 0: pp->setId(string2long(value)); return true;
+        case 1: pp->setRound(string2long(value)); return true;
+        case 2: pp->setCount(string2long(value)); return true;
+        case 3: pp->setOldest(string2simtime(value)); return true;
+        case 4: pp->setNewest(string2simtime(value)); return true;
+        default: return false;
+    }
+}
+
+const char *mAggregateDescriptor::getFieldStructName(int field) const
+{
+    omnetpp::cClassDescriptor *basedesc = getBaseClassDescriptor();
+    if (basedesc) {
+        if (field < basedesc->getFieldCount())
+            return basedesc->getFieldStructName(field);
+        field -= basedesc->getFieldCount();
+    }
+    switch (field) {
+        case 5: return omnetpp::opp_typename(typeid(PayloadBytes));
+        default: return nullptr;
+    };
+}
+
+void *mAggregateDescriptor::getFieldStructValuePointer(void *object, int field, int i) const
+{
+    omnetpp::cClassDescriptor *basedesc = getBaseClassDescriptor();
+    if (basedesc) {
+        if (field < basedesc->getFieldCount())
+            return basedesc->getFieldStructValuePointer(object, field, i);
+        field -= basedesc->getFieldCount();
+    }
+    mAggregate *pp = (mAggregate *)object; (void)pp;
+    switch (field) {
+        case 5: return (void *)(&pp->getPayload()); break;
+        default: return nullptr;
+    }
+}
+
 
@@ -16,10 +16,12 @@
 #    error Version mismatch! Probably this file was generated by an earlier version of nedtool: 'make clean' should help.
 #endif
 
-
+// cplusplus {{
+#include "aggregation.h"
+// }}
 
 /**
- * Class generated from <tt>common.msg:19</tt> by nedtool.
+ * Class generated from <tt>common.msg:25</tt> by nedtool.
  * <pre>
  * //
  * // ADV message
@@ -60,13 +62,15 @@ inline void doParsimPacking(omnetpp::cCommBuffer *b, const mAdvertisement& obj)
 inline void doParsimUnpacking(omnetpp::cCommBuffer *b, mAdvertisement& obj) {obj.parsimUnpack(b);}
 
 /**
- * Class generated from <tt>common.msg:23</tt> by nedtool.
+ * Class generated from <tt>common.msg:29</tt> by nedtool.
  * <pre>
  * // DATA message
  * message mData
  * {
  *     int id;	// sender id
  *     int round; // round number
+ *     simtime_t created; // time the reading was taken
+ *     SampleVector samples; // payload (samplesPerReading values)
  * }
  * </pre>
  */
@@ -75,6 +79,8 @@ class mData : public ::omnetpp::cMessage
   protected:
     int id;
     int round;
+    ::omnetpp::simtime_t created;
+    SampleVector samples;
 
   private:
     void copy(const mData& other);
@@ -97,13 +103,18 @@ class mData : public ::omnetpp::cMessage
     virtual void setId(int id);
     virtual int getRound() const;
     virtual void setRound(int round);
+    virtual ::omnetpp::simtime_t getCreated() const;
+    virtual void setCreated(::omnetpp::simtime_t created);
+    virtual SampleVector& getSamples();
+    virtual const SampleVector& getSamples() const {return const_cast<mData*>(this)->getSamples();}
+    virtual void setSamples(const SampleVector& samples);
 };
 
 inline void doParsimPacking(omnetpp::cCommBuffer *b, const mData& obj) {obj.parsimPack(b);}
 inline void doParsimUnpacking(omnetpp::cCommBuffer *b, mData& obj) {obj.parsimUnpack(b);}
 
 /**
- * Class generated from <tt>common.msg:28</tt> by nedtool.
+ * Class generated from <tt>common.msg:36</tt> by nedtool.
  * <pre>
  * // JOIN message
  * message mJoin
@@ -145,7 +156,7 @@ inline void doParsimPacking(omnetpp::cCommBuffer *b, const mJoin& obj) {obj.pars
 inline void doParsimUnpacking(omnetpp::cCommBuffer *b, mJoin& obj) {obj.parsimUnpack(b);}
 
 /**
- * Class generated from <tt>common.msg:35</tt> by nedtool.
+ * Class generated from <tt>common.msg:43</tt> by nedtool.
  * <pre>
  * // SCHED message
  * message mSchedule
@@ -196,7 +207,7 @@ inline void doParsimPacking(omnetpp::cCommBuffer *b, const mSchedule& obj) {obj.
 inline void doParsimUnpacking(omnetpp::cCommBuffer *b, mSchedule& obj) {obj.parsimUnpack(b);}
 
 /**
- * Class generated from <tt>common.msg:43</tt> by nedtool.
+ * Class generated from <tt>common.msg:51</tt> by nedtool.
  * <pre>
  * // ALTERNATIVE CH SELCTION
  * message mCenterCH
@@ -242,6 +253,66 @@ class mCenterCH : public ::omnetpp::cMessage
 inline void doParsimPacking(omnetpp::cCommBuffer *b, const mCenterCH& obj) {obj.parsimPack(b);}
 inline void doParsimUnpacking(omnetpp::cCommBuffer *b, mCenterCH& obj) {obj.parsimUnpack(b);}
 
+/**
+ * Class generated from <tt>common.msg:58</tt> by nedtool.
+ * <pre>
+ * // CH aggregate sent to the BS
+ * message mAggregate
+ * {
+ *     int id; // CH id
+ *     int round; // round number
+ *     int count; // DATA aggregated
+ *     simtime_t oldest; // creation time of the oldest DATA
+ *     simtime_t newest; // creation time of the newest DATA
+ *     PayloadBytes payload; // encoded by the CH (see ClusterAggregator)
+ * }
+ * </pre>
+ */
+class mAggregate : public ::omnetpp::cMessage
+{
+  protected:
+    int id;
+    int round;
+    int count;
+    ::omnetpp::simtime_t oldest;
+    ::omnetpp::simtime_t newest;
+    PayloadBytes payload;
+
+  private:
+    void copy(const mAggregate& other);
+
+  protected:
+    // protected and unimplemented operator==(), to prevent accidental usage
+    bool operator==(const mAggregate&);
+
+  public:
+    mAggregate(const char *name=nullptr, short kind=0);
+    mAggregate(const mAggregate& other);
+    virtual ~mAggregate();
+    mAggregate& operator=(const mAggregate& other);
+    virtual mAggregate *dup() const override {return new mAggregate(*this);}
+    virtual void parsimPack(omnetpp::cCommBuffer *b) const override;
+    virtual void parsimUnpack(omnetpp::cCommBuffer *b) override;
+
+    // field getter/setter methods
+    virtual int getId() const;
+    virtual void setId(int id);
+    virtual int getRound() const;
+    virtual void setRound(int round);
+    virtual int getCount() const;
+    virtual void setCount(int count);
+    virtual ::omnetpp::simtime_t getOldest() const;
+    virtual void setOldest(::omnetpp::simtime_t oldest);
+    virtual ::omnetpp::simtime_t getNewest() const;
+    virtual void setNewest(::omnetpp::simtime_t newest);
+    virtual PayloadBytes& getPayload();
+    virtual const PayloadBytes& getPayload() const {return const_cast<mAggregate*>(this)->getPayload();}
+    virtual void setPayload(const PayloadBytes& payload);
+};
+
+inline void doParsimPacking(omnetpp::cCommBuffer *b, const mAggregate& obj) {obj.parsimPack(b);}
+inline void doParsimUnpacking(omnetpp::cCommBuffer *b, mAggregate& obj) {obj.parsimUnpack(b);}
+
 
 #endif // ifndef __COMMON_M_H
 
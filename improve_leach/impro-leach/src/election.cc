@@ -0,0 +1,87 @@
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with this program.  If not, see http://www.gnu.org/licenses/.
+//
+
+#include <cstring>
+#include "common.h"
+#include "election.h"
+
+#define HEED_P_MIN 1e-4 // minimum CH probability of HEED
+
+ElectionStrategy *ElectionStrategy::create(const char *name)
+{
+    if(!strcmp(name, "leach")) return new LeachElection();
+    if(!strcmp(name, "leach-e")) return new LeachEElection();
+    if(!strcmp(name, "sep")) return new SepElection();
+    if(!strcmp(name, "heed")) return new HeedElection();
+    return nullptr;
+}
+
+void ElectionStrategy::beginRound(int r, double p, const LifetimeStats &net)
+{
+    round = r;
+    P = p;
+}
+
+double ElectionStrategy::threshold(double energy, double initial, bool alreadyCH) const
+{
+    double th;
+    uint8_t already = alreadyCH;
+    thresholds(&energy, &initial, &already, 1, &th);
+    return th;
+}
+
+void LeachElection::beginRound(int r, double p, const LifetimeStats &net)
+{
+    ElectionStrategy::beginRound(r, p, net);
+    base = leachThreshold(P, round, false);
+}
+
+void LeachElection::thresholds(const double *energy, const double *initial, const uint8_t *alreadyCH, unsigned int n, double *th) const
+{
+    for(unsigned int i = 0; i < n; i++)
+        th[i] = alreadyCH[i] ? 0 : base;
+}
+
+void LeachEElection::beginRound(int r, double p, const LifetimeStats &net)
+{
+    LeachElection::beginRound(r, p, net);
+    invAverage = net.getAverageEnergy() > 0 ? 1 / net.getAverageEnergy() : 0;
+}
+
+void LeachEElection::thresholds(const double *energy, const double *initial, const uint8_t *alreadyCH, unsigned int n, double *th) const
+{
+    for(unsigned int i = 0; i < n; i++)
+        th[i] = alreadyCH[i] ? 0 : base * energy[i] * invAverage;
+}
+
+void SepElection::beginRound(int r, double p, const LifetimeStats &net)
+{
+    LeachElection::beginRound(r, p, net);
+    invInitial = net.getInitialEnergy() > 0 ? net.getN() / net.getInitialEnergy() : 0;
+}
+
+void SepElection::thresholds(const double *energy, const double *initial, const uint8_t *alreadyCH, unsigned int n, double *th) const
+{
+    for(unsigned int i = 0; i < n; i++)
+        th[i] = alreadyCH[i] ? 0 : base * initial[i] * invInitial;
+}
+
+void HeedElection::thresholds(const double *energy, const double *initial, const uint8_t *alreadyCH, unsigned int n, double *th) const
+{
+    for(unsigned int i = 0; i < n; i++){
+        double p = P * energy[i] / initial[i];
+        th[i] = (P > 0 && p < HEED_P_MIN) ? HEED_P_MIN : p;
+    }
+}
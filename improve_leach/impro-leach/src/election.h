@@ -0,0 +1,98 @@
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with this program.  If not, see http://www.gnu.org/licenses/.
+//
+
+#ifndef __IMPRO_LEACH_ELECTION_H_
+#define __IMPRO_LEACH_ELECTION_H_
+
+#include <cstdint>
+#include "lifetime.h"
+
+/**
+ * CH election threshold T(n), selected by the Base_net "election" parameter.
+ *
+ * beginRound() computes the per-round constants once; thresholds() then
+ * evaluates a whole array of nodes with a branch-free loop, so the batched
+ * setup at the BS gets one vectorized pass and a single node just passes
+ * arrays of length one.
+ */
+class ElectionStrategy
+{
+  protected:
+    int round = -1;
+    double P = 0;
+
+  public:
+    virtual ~ElectionStrategy() {}
+    virtual void beginRound(int r, double p, const LifetimeStats &net);
+    virtual void thresholds(const double *energy, const double *initial, const uint8_t *alreadyCH, unsigned int n, double *th) const = 0;
+    double threshold(double energy, double initial, bool alreadyCH) const;
+
+    // nullptr for an unknown name
+    static ElectionStrategy *create(const char *name);
+};
+
+/**
+ * LEACH: P/(1-P*(r mod 1/P)) for nodes that have not been CH in the epoch.
+ */
+class LeachElection : public ElectionStrategy
+{
+  protected:
+    double base = 0;
+
+  public:
+    virtual void beginRound(int r, double p, const LifetimeStats &net);
+    virtual void thresholds(const double *energy, const double *initial, const uint8_t *alreadyCH, unsigned int n, double *th) const;
+};
+
+/**
+ * LEACH-E / DEEC: LEACH threshold scaled by residual over average network energy.
+ */
+class LeachEElection : public LeachElection
+{
+  protected:
+    double invAverage = 0;
+
+  public:
+    virtual void beginRound(int r, double p, const LifetimeStats &net);
+    virtual void thresholds(const double *energy, const double *initial, const uint8_t *alreadyCH, unsigned int n, double *th) const;
+};
+
+/**
+ * SEP for heterogeneous batteries: LEACH threshold weighted by initial over
+ * average initial energy, so that better equipped nodes are CH more often
+ * (the two-level normal/advanced split generalized to any distribution).
+ */
+class SepElection : public LeachElection
+{
+  protected:
+    double invInitial = 0;
+
+  public:
+    virtual void beginRound(int r, double p, const LifetimeStats &net);
+    virtual void thresholds(const double *energy, const double *initial, const uint8_t *alreadyCH, unsigned int n, double *th) const;
+};
+
+/**
+ * HEED-like: CH probability P*residual/initial, never below HEED's p_min.
+ * Only the probability of HEED is used, not its iterative tentative-CH
+ * rounds; there is no epoch, so former CHs can be elected again.
+ */
+class HeedElection : public ElectionStrategy
+{
+  public:
+    virtual void thresholds(const double *energy, const double *initial, const uint8_t *alreadyCH, unsigned int n, double *th) const;
+};
+
+#endif
@@ -0,0 +1,105 @@
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with this program.  If not, see http://www.gnu.org/licenses/.
+//
+
+#include <algorithm>
+#include <cmath>
+#include "histogram.h"
+
+#define HIST_SUB_BUCKETS 32     // buckets per power of two, ~1.6% relative error
+#define HIST_MIN_EXP -20        // 2^-20 s (~1 us): smaller values share the first bucket
+#define HIST_MAX_EXP 14         // 2^14 s: larger values share the last bucket
+#define HIST_BUCKETS ((HIST_MAX_EXP - HIST_MIN_EXP) * HIST_SUB_BUCKETS)
+
+StreamingHistogram::StreamingHistogram() : counts(HIST_BUCKETS, 0)
+{
+    lo = HIST_BUCKETS;
+    hi = -1;
+}
+
+int StreamingHistogram::bucket(double v) const
+{
+    int e;
+    double m = frexp(v, &e); // v = m * 2^e, m in [0.5, 1)
+    int b = (e - 1 - HIST_MIN_EXP) * HIST_SUB_BUCKETS + (int) ((2*m - 1) * HIST_SUB_BUCKETS);
+    return std::min(std::max(b, 0), HIST_BUCKETS - 1);
+}
+
+double StreamingHistogram::bucketValue(int b) const
+{
+    // middle of the bucket
+    int e = b / HIST_SUB_BUCKETS + HIST_MIN_EXP;
+    double sub = b % HIST_SUB_BUCKETS + 0.5;
+    return ldexp(1 + sub / HIST_SUB_BUCKETS, e);
+}
+
+void StreamingHistogram::add(double v)
+{
+    if(n == 0) min = max = v;
+    min = std::min(min, v);
+    max = std::max(max, v);
+    sum += v;
+    n++;
+    if(v <= 0){
+        zeros++;
+        return;
+    }
+    int b = bucket(v);
+    counts[b]++;
+    lo = std::min(lo, b);
+    hi = std::max(hi, b);
+}
+
+void StreamingHistogram::merge(const StreamingHistogram &o)
+{
+    if(o.n == 0) return;
+    if(n == 0){
+        min = o.min;
+        max = o.max;
+    }
+    min = std::min(min, o.min);
+    max = std::max(max, o.max);
+    sum += o.sum;
+    n += o.n;
+    zeros += o.zeros;
+    for(int b = o.lo; b <= o.hi; b++)
+        counts[b] += o.counts[b];
+    lo = std::min(lo, o.lo);
+    hi = std::max(hi, o.hi);
+}
+
+void StreamingHistogram::reset()
+{
+    // only the buckets used since the last reset
+    if(hi >= lo) std::fill(counts.begin() + lo, counts.begin() + hi + 1, 0);
+    lo = HIST_BUCKETS;
+    hi = -1;
+    zeros = n = 0;
+    sum = min = max = 0;
+}
+
+double StreamingHistogram::quantile(double q) const
+{
+    if(n == 0) return 0;
+    unsigned long rank = (unsigned long) ceil(q * n); // 1-based
+    if(rank < 1) rank = 1;
+    if(rank <= zeros) return min;
+    unsigned long seen = zeros;
+    for(int b = lo; b <= hi; b++){
+        seen += counts[b];
+        if(seen >= rank)
+            return std::min(std::max(bucketValue(b), min), max);
+    }
+    return max;
+}
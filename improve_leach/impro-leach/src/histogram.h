@@ -0,0 +1,52 @@
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with this program.  If not, see http://www.gnu.org/licenses/.
+//
+
+#ifndef __IMPRO_LEACH_HISTOGRAM_H_
+#define __IMPRO_LEACH_HISTOGRAM_H_
+
+#include <vector>
+
+/**
+ * Streaming histogram of positive values (latencies in seconds) with
+ * log-linear buckets: each power of two is split into HIST_SUB_BUCKETS
+ * equal buckets, so quantiles have a bounded relative error whatever the
+ * scale. add() is O(1); quantiles cost one pass over the buckets.
+ */
+class StreamingHistogram
+{
+  private:
+    std::vector<unsigned long> counts;
+    unsigned long zeros = 0;    // values <= 0
+    unsigned long n = 0;
+    double sum = 0, min = 0, max = 0;
+    int lo, hi;                 // range of the non-empty buckets
+
+    int bucket(double v) const;
+    double bucketValue(int b) const;
+
+  public:
+    StreamingHistogram();
+    void add(double v);
+    void merge(const StreamingHistogram &o);
+    void reset();
+    double quantile(double q) const;
+
+    unsigned long getCount() const { return n; }
+    double getMean() const { return n ? sum / n : 0; }
+    double getMin() const { return min; }
+    double getMax() const { return max; }
+};
+
+#endif
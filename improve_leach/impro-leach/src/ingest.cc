@@ -0,0 +1,260 @@
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with this program.  If not, see http://www.gnu.org/licenses/.
+//
+
+#include <chrono>
+#include <cstring>
+#ifndef _WIN32
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#endif
+#include "ingest.h"
+#include "codec.h"
+#include "common.h"
+
+using namespace omnetpp;
+
+#define INGEST_MAGIC "LEACHAGG"
+#define INGEST_VERSION 2
+#define INGEST_CHUNK_ROWS 4096  // records encoded together
+#define INGEST_IDLE_SPINS 64    // empty polls the consumer only yields for
+#define INGEST_IDLE_SLEEP 1     // ms the consumer sleeps after that, on an empty ring
+
+/********* Ring **********/
+void SpscRing::init(size_t bytes)
+{
+    capacity = 64;
+    while(capacity < bytes)
+        capacity <<= 1;
+    buf.assign(capacity, 0);
+    head.store(0);
+    tail.store(0);
+    cachedHead = cachedTail = 0;
+}
+
+void SpscRing::copyIn(size_t pos, const void *src, size_t n)
+{
+    size_t off = pos & (capacity - 1);
+    size_t first = std::min(n, capacity - off);
+    memcpy(&buf[off], src, first);
+    if(n > first) memcpy(&buf[0], (const uint8_t *) src + first, n - first);
+}
+
+void SpscRing::copyOut(size_t pos, void *dst, size_t n) const
+{
+    size_t off = pos & (capacity - 1);
+    size_t first = std::min(n, capacity - off);
+    memcpy(dst, &buf[off], first);
+    if(n > first) memcpy((uint8_t *) dst + first, &buf[0], n - first);
+}
+
+bool SpscRing::push(const void *a, size_t na, const void *b, size_t nb)
+{
+    uint32_t len = na + nb;
+    size_t need = (sizeof(len) + len + 7) & ~(size_t) 7;
+    if(need > capacity) return false;
+    size_t t = tail.load(std::memory_order_relaxed);
+    if(t + need - cachedHead > capacity){
+        cachedHead = head.load(std::memory_order_acquire);
+        if(t + need - cachedHead > capacity) return false; // full
+    }
+    copyIn(t, &len, sizeof(len));
+    copyIn(t + sizeof(len), a, na);
+    if(nb > 0) copyIn(t + sizeof(len) + na, b, nb);
+    tail.store(t + need, std::memory_order_release);
+    return true;
+}
+
+bool SpscRing::pop(std::vector<uint8_t> &out)
+{
+    size_t h = head.load(std::memory_order_relaxed);
+    if(h == cachedTail){
+        cachedTail = tail.load(std::memory_order_acquire);
+        if(h == cachedTail) return false; // empty
+    }
+    uint32_t len;
+    copyOut(h, &len, sizeof(len));
+    out.resize(len);
+    copyOut(h + sizeof(len), out.data(), len);
+    head.store(h + ((sizeof(len) + len + 7) & ~(size_t) 7), std::memory_order_release);
+    return true;
+}
+
+/********* Sink **********/
+void IngestSink::open(const char *sink, size_t ringBytes, const char *operators, double resolution, int samplesPerReading)
+{
+    sinkName = sink;
+    std::vector<uint8_t> header(INGEST_MAGIC, INGEST_MAGIC + 8);
+    uint32_t version = INGEST_VERSION;
+    header.insert(header.end(), (const uint8_t *) &version, (const uint8_t *) &version + sizeof(version));
+
+    // how the payloads that follow are encoded
+    std::vector<uint8_t> config, record;
+    putString(config, operators);
+    config.insert(config.end(), (const uint8_t *) &resolution, (const uint8_t *) &resolution + sizeof(resolution));
+    putVarint(config, samplesPerReading);
+    record.push_back('G');
+    putVarint(record, config.size());
+    record.insert(record.end(), config.begin(), config.end());
+
+    if(!strncmp(sink, "file:", 5)){
+        f = fopen(sink + 5, "ab");
+        if(!f)
+            throw cRuntimeError("Cannot open ingestion file '%s'", sink + 5);
+        fseek(f, 0, SEEK_END); // the position of an "a" stream is implementation-defined until the first write
+        if(ftell(f) == 0)
+            fwrite(header.data(), 1, header.size(), f);
+        fwrite(record.data(), 1, record.size(), f);
+    }
+    else if(!strncmp(sink, "unix:", 5)){
+#ifdef _WIN32
+        throw cRuntimeError("Unix-domain ingestion sockets are not supported on this platform");
+#else
+        sockaddr_un addr;
+        memset(&addr, 0, sizeof(addr));
+        addr.sun_family = AF_UNIX;
+        if(strlen(sink + 5) >= sizeof(addr.sun_path))
+            throw cRuntimeError("Ingestion socket path '%s' is too long", sink + 5);
+        strcpy(addr.sun_path, sink + 5);
+        sock = socket(AF_UNIX, SOCK_STREAM, 0);
+        if(sock < 0 || connect(sock, (sockaddr *) &addr, sizeof(addr)) < 0){
+            if(sock >= 0) ::close(sock);
+            sock = -1;
+            throw cRuntimeError("Cannot connect to ingestion socket '%s'", sink + 5);
+        }
+#ifdef SO_NOSIGPIPE
+        int one = 1;
+        setsockopt(sock, SOL_SOCKET, SO_NOSIGPIPE, &one, sizeof(one));
+#endif
+        write(header);
+        write(record);
+#endif
+    }
+    else
+        throw cRuntimeError("Unknown ingestion sink '%s' (file:<path> or unix:<path>)", sink);
+
+    ring.init(ringBytes);
+    stopping.store(false);
+    consumer = std::thread(&IngestSink::consumerLoop, this);
+}
+
+void IngestSink::close()
+{
+    if(!consumer.joinable()) return;
+    stopping.store(true, std::memory_order_release);
+    consumer.join(); // drains what is left
+    if(f) fclose(f);
+    f = nullptr;
+#ifndef _WIN32
+    if(sock >= 0) ::close(sock);
+#endif
+    sock = -1;
+}
+
+void IngestSink::push(const IngestRecord &r, const void *payload)
+{
+    pushed++;
+    if(!ring.push(&r, sizeof(r), payload, r.payloadBytes))
+        dropped++;
+}
+
+bool IngestSink::write(const std::vector<uint8_t> &bytes)
+{
+    if(failed) return false;
+    bool ok = true;
+    if(f)
+        ok = fwrite(bytes.data(), 1, bytes.size(), f) == bytes.size();
+#ifndef _WIN32
+    else if(sock >= 0){
+#ifdef MSG_NOSIGNAL
+        int flags = MSG_NOSIGNAL;
+#else
+        int flags = 0;
+#endif
+        for(size_t sent = 0; ok && sent < bytes.size(); ){
+            ssize_t k = send(sock, bytes.data() + sent, bytes.size() - sent, flags);
+            if(k > 0) sent += k;
+            else ok = false;
+        }
+    }
+#endif
+    if(!ok) failed = true; // keep draining the ring, the records are lost
+    return ok;
+}
+
+void IngestSink::consumerLoop()
+{
+    std::vector<int64_t> ch, round, repetition, count, size;
+    std::vector<double> arrival, oldest, newest;
+    std::vector<uint8_t> rec, payloads, column, chunk, out;
+    unsigned int idle = 0;
+    while(true){
+        // everything pushed before stopping was set is in the ring now
+        bool stop = stopping.load(std::memory_order_acquire);
+        ch.clear(); round.clear(); repetition.clear(); count.clear(); size.clear();
+        arrival.clear(); oldest.clear(); newest.clear();
+        payloads.clear();
+        while(ch.size() < INGEST_CHUNK_ROWS && ring.pop(rec)){
+            IngestRecord r;
+            memcpy(&r, rec.data(), sizeof(r));
+            ch.push_back(r.ch);
+            round.push_back(r.round);
+            repetition.push_back(r.repetition);
+            count.push_back(r.count);
+            size.push_back(r.payloadBytes);
+            arrival.push_back(r.arrival);
+            oldest.push_back(r.oldest);
+            newest.push_back(r.newest);
+            payloads.insert(payloads.end(), rec.begin() + sizeof(r), rec.end());
+        }
+        size_t n = ch.size();
+        if(n == 0){
+            if(stop) break;
+            if(++idle < INGEST_IDLE_SPINS)
+                std::this_thread::yield();
+            else
+                std::this_thread::sleep_for(std::chrono::milliseconds(INGEST_IDLE_SLEEP));
+            continue;
+        }
+        idle = 0;
+
+        chunk.clear();
+        putVarint(chunk, n);
+        for(int col = 0; col < 8; col++){
+            column.clear();
+            switch(col){
+                case 0: encodeDeltaInts(column, ch.data(), n); break;
+                case 1: encodeDeltaInts(column, round.data(), n); break;
+                case 2: encodeDeltaInts(column, repetition.data(), n); break;
+                case 3: encodeDeltaInts(column, count.data(), n); break;
+                case 4: encodeDeltaInts(column, size.data(), n); break;
+                case 5: encodeXorDoubles(column, arrival.data(), n); break;
+                case 6: encodeXorDoubles(column, oldest.data(), n); break;
+                case 7: encodeXorDoubles(column, newest.data(), n); break;
+            }
+            putVarint(chunk, column.size());
+            chunk.insert(chunk.end(), column.begin(), column.end());
+        }
+        chunk.insert(chunk.end(), payloads.begin(), payloads.end());
+
+        out.clear();
+        out.push_back('A');
+        putVarint(out, chunk.size());
+        out.insert(out.end(), chunk.begin(), chunk.end());
+        if(write(out))
+            written += n;
+    }
+    if(f) fflush(f);
+}
@@ -0,0 +1,122 @@
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with this program.  If not, see http://www.gnu.org/licenses/.
+//
+
+#ifndef __IMPRO_LEACH_INGEST_H_
+#define __IMPRO_LEACH_INGEST_H_
+
+#include <atomic>
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <thread>
+#include <vector>
+
+/**
+ * Lock-free single-producer single-consumer ring of variable-size records.
+ *
+ * Records are a 32-bit length and the bytes, padded to 8 bytes. Each side
+ * keeps its own copy of the other index and reads the shared one only when
+ * the copy says the ring is full (producer) or empty (consumer), so in the
+ * common case a push or pop touches no cache line written by the other thread.
+ * A push that does not fit fails: the producer never waits.
+ */
+class SpscRing
+{
+  private:
+    std::vector<uint8_t> buf;
+    size_t capacity = 0;        // power of two
+    char pad0[64];
+    std::atomic<size_t> head;   // next byte to read, written by the consumer
+    size_t cachedTail = 0;      // consumer's copy of tail
+    char pad1[64];
+    std::atomic<size_t> tail;   // next byte to write, written by the producer
+    size_t cachedHead = 0;      // producer's copy of head
+    char pad2[64];
+
+    void copyIn(size_t pos, const void *src, size_t n);
+    void copyOut(size_t pos, void *dst, size_t n) const;
+
+  public:
+    SpscRing() : head(0), tail(0) {}
+    void init(size_t bytes);    // rounded up to a power of two
+    bool push(const void *a, size_t na, const void *b, size_t nb); // record a+b
+    bool pop(std::vector<uint8_t> &out);
+};
+
+/**
+ * Aggregate as received by the BS, header of a ring record (followed by
+ * the payload bytes).
+ */
+struct IngestRecord
+{
+    double arrival;             // s
+    double oldest, newest;      // creation time of the readings
+    int32_t ch;                 // sender CH, -1 for the DATA of an orphan
+    int32_t round;
+    int32_t repetition;         // warm repetition (rounds start over in each one)
+    int32_t count;              // readings
+    uint32_t payloadBytes;      // encoded aggregate, raw float32 samples for an orphan
+};
+
+/**
+ * BS ingestion stage: the simulation thread copies each aggregate into an
+ * SpscRing (drops it if the ring is full), a consumer thread drains it in
+ * chunks to a sink:
+ *   "file:<path>"  columnar file: INGEST_MAGIC, version, then records of a
+ *                  type byte and a varint length. Each open() writes a 'G'
+ *                  record with the aggregation the payloads are encoded with
+ *                  (operators string, sampleResolution as a raw double,
+ *                  samplesPerReading varint); the 'A' records after it are
+ *                  chunks stored column by column like ColumnarStore chunks:
+ *                  rows, then ch, round, repetition, count, payload size
+ *                  (delta ints), arrival, oldest, newest (xor doubles), then
+ *                  the payloads back to back;
+ *   "unix:<path>"  the same byte stream to a local stream socket.
+ * Only open() and close() may wait; push() never does.
+ */
+class IngestSink
+{
+  private:
+    SpscRing ring;
+    std::thread consumer;
+    std::atomic<bool> stopping;
+    FILE *f = nullptr;
+    int sock = -1;
+    std::string sinkName;
+
+    unsigned long pushed = 0, dropped = 0; // simulation thread
+    std::atomic<unsigned long> written;    // records written by the consumer
+    std::atomic<bool> failed;
+
+    void consumerLoop();
+    bool write(const std::vector<uint8_t> &bytes);
+
+  public:
+    IngestSink() : stopping(false), written(0), failed(false) {}
+    ~IngestSink() { close(); }
+
+    // throws on a malformed sink or if it cannot be opened
+    void open(const char *sink, size_t ringBytes, const char *operators, double resolution, int samplesPerReading);
+    void close();
+    bool isOpen() const { return consumer.joinable(); }
+    void push(const IngestRecord &r, const void *payload);
+
+    unsigned long getPushed() const { return pushed; }
+    unsigned long getDropped() const { return dropped; }
+    unsigned long getWritten() const { return written; }
+    bool hasFailed() const { return failed; }
+};
+
+#endif
@@ -0,0 +1,276 @@
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with this program.  If not, see http://www.gnu.org/licenses/.
+//
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <thread>
+#include "kmeans.h"
+
+#define KMEANS_MIN_CHUNK 4096 // points per thread below which threads are not worth it
+
+void KMeans::seed(const double *x, const double *y, unsigned int n, unsigned int k)
+{
+    // keep the centroids of the previous call, add evenly strided points until there are k
+    if(cx.size() > k){
+        cx.resize(k);
+        cy.resize(k);
+    }
+    for(unsigned int j = cx.size(); j < k; j++){
+        unsigned int i = ((unsigned long long) j * n) / k;
+        cx.push_back(x[i]);
+        cy.push_back(y[i]);
+    }
+}
+
+void KMeans::buildGrid()
+{
+    // uniform grid over the centroids, about one centroid per cell
+    unsigned int k = cx.size();
+    double minX = *std::min_element(cx.begin(), cx.end()), maxX = *std::max_element(cx.begin(), cx.end());
+    double minY = *std::min_element(cy.begin(), cy.end()), maxY = *std::max_element(cy.begin(), cy.end());
+    cell = std::max(sqrt((maxX - minX) * (maxY - minY) / k), std::max(maxX - minX, maxY - minY) / k);
+    if(cell <= 0) cell = 1;
+    gridX0 = minX;
+    gridY0 = minY;
+    gridW = (int) ((maxX - minX) / cell) + 1;
+    gridH = (int) ((maxY - minY) / cell) + 1;
+
+    cellBegin.assign(gridW*gridH + 1, 0);
+    for(unsigned int j = 0; j < k; j++)
+        cellBegin[cellOf(cx[j], cy[j]) + 1]++;
+    for(int c = 0; c < gridW*gridH; c++)
+        cellBegin[c+1] += cellBegin[c];
+    std::vector<int> fill(cellBegin.begin(), cellBegin.end() - 1);
+    cellItems.resize(k);
+    for(unsigned int j = 0; j < k; j++)
+        cellItems[fill[cellOf(cx[j], cy[j])]++] = j;
+}
+
+void KMeans::nearestTwo(double px, double py, int &best, double &d1, double &d2) const
+{
+    // closest and second closest centroid (lowest index on ties), searching rings of cells around the point
+    double b1 = std::numeric_limits<double>::infinity(), b2 = b1;
+    best = -1;
+    int gx = std::min(std::max((int) ((px - gridX0) / cell), 0), gridW - 1);
+    int gy = std::min(std::max((int) ((py - gridY0) / cell), 0), gridH - 1);
+    int rings = std::max(gridW, gridH);
+    for(int r = 0; r <= rings; r++){
+        for(int cyi = gy - r; cyi <= gy + r; cyi++){
+            if(cyi < 0 || cyi >= gridH) continue;
+            bool edge = (cyi == gy - r) || (cyi == gy + r);
+            for(int cxi = gx - r; cxi <= gx + r; cxi += edge ? 1 : 2*r){
+                if(cxi >= 0 && cxi < gridW){
+                    int c = cyi*gridW + cxi;
+                    for(int m = cellBegin[c]; m < cellBegin[c+1]; m++){
+                        int j = cellItems[m];
+                        double dx = px - cx[j], dy = py - cy[j];
+                        double d = dx*dx + dy*dy;
+                        if(d < b1 || (d == b1 && j < best)){
+                            b2 = b1;
+                            b1 = d;
+                            best = j;
+                        }
+                        else if(d < b2)
+                            b2 = d;
+                    }
+                }
+                if(r == 0) break;
+            }
+        }
+        // cells of the next ring are at least r*cell away
+        if(b2 <= (r*cell)*(r*cell)) break;
+    }
+    d1 = sqrt(b1);
+    d2 = sqrt(b2);
+}
+
+static inline void clearPartial(std::vector<double> &sumX, std::vector<double> &sumY, std::vector<unsigned int> &count, unsigned int k)
+{
+    sumX.assign(k, 0);
+    sumY.assign(k, 0);
+    count.assign(k, 0);
+}
+
+void KMeans::initBounds(const double *x, const double *y, unsigned int lo, unsigned int hi, Partial &p)
+{
+    clearPartial(p.sumX, p.sumY, p.count, cx.size());
+    p.changed = hi - lo;
+    for(unsigned int i = lo; i < hi; i++){
+        nearestTwo(x[i], y[i], assignment[i], upper[i], lower[i]);
+        p.sumX[assignment[i]] += x[i];
+        p.sumY[assignment[i]] += y[i];
+        p.count[assignment[i]]++;
+    }
+}
+
+void KMeans::assign(const double *x, const double *y, unsigned int lo, unsigned int hi, Partial &p)
+{
+    clearPartial(p.sumX, p.sumY, p.count, cx.size());
+    p.changed = 0;
+    for(unsigned int i = lo; i < hi; i++){
+        int a = assignment[i];
+        // bounds after the last centroid update
+        upper[i] += moved[a];
+        lower[i] -= (a == maxMovedIdx) ? maxMoved2 : maxMoved;
+        double m = std::max(s[a], lower[i]);
+        if(upper[i] > m){
+            double dx = x[i] - cx[a], dy = y[i] - cy[a];
+            upper[i] = sqrt(dx*dx + dy*dy);
+            if(upper[i] > m){
+                nearestTwo(x[i], y[i], assignment[i], upper[i], lower[i]);
+                if(assignment[i] != a) p.changed++;
+            }
+        }
+        p.sumX[assignment[i]] += x[i];
+        p.sumY[assignment[i]] += y[i];
+        p.count[assignment[i]]++;
+    }
+}
+
+KMeans::~KMeans()
+{
+    {
+        std::lock_guard<std::mutex> guard(lock);
+        stopping = true;
+    }
+    started.notify_all();
+    for(std::thread &w : workers)
+        w.join();
+}
+
+void KMeans::runChunk(unsigned int t)
+{
+    unsigned int lo = std::min(jobN, t*jobSize), hi = std::min(jobN, lo + jobSize);
+    (this->*jobFn)(jobX, jobY, lo, hi, partials[t]);
+}
+
+void KMeans::workerLoop(unsigned int t)
+{
+    unsigned long seen = 0;
+    while(true){
+        {
+            std::unique_lock<std::mutex> guard(lock);
+            started.wait(guard, [this, seen]() { return stopping || generation != seen; });
+            if(stopping) return;
+            seen = generation;
+            if(t >= chunks) continue;   // not needed for this pass
+        }
+        runChunk(t);
+        bool last;
+        {
+            std::lock_guard<std::mutex> guard(lock);
+            last = --pending == 0;
+        }
+        if(last) finished.notify_one();
+    }
+}
+
+void KMeans::forEachChunk(unsigned int n, ChunkFn f, const double *x, const double *y)
+{
+    unsigned int c = std::max(1u, std::min(threads, n / KMEANS_MIN_CHUNK));
+    if(c == 1){
+        chunks = 1;
+        partials.resize(1);
+        (this->*f)(x, y, 0, n, partials[0]);
+        return;
+    }
+    // workers are only started once and then reused by every pass of every run
+    {
+        std::lock_guard<std::mutex> guard(lock);
+        chunks = c;
+        partials.resize(chunks);
+        jobFn = f;
+        jobX = x;
+        jobY = y;
+        jobN = n;
+        jobSize = (n + chunks - 1) / chunks;
+        pending = chunks - 1;
+        generation++;
+    }
+    while(workers.size() + 1 < chunks)
+        workers.emplace_back(&KMeans::workerLoop, this, (unsigned int) workers.size() + 1);
+    started.notify_all();
+    runChunk(0);
+    std::unique_lock<std::mutex> guard(lock);
+    finished.wait(guard, [this]() { return pending == 0; });
+}
+
+bool KMeans::updateCentroids()
+{
+    // partial sums are merged in chunk order, so results do not depend on thread timing
+    unsigned int k = cx.size();
+    unsigned int changed = 0;
+    moved.assign(k, 0);
+    maxMoved = maxMoved2 = 0;
+    maxMovedIdx = -1;
+    for(unsigned int t = 0; t < chunks; t++)
+        changed += partials[t].changed;
+    for(unsigned int j = 0; j < k; j++){
+        double sx = 0, sy = 0;
+        unsigned int c = 0;
+        for(unsigned int t = 0; t < chunks; t++){
+            sx += partials[t].sumX[j];
+            sy += partials[t].sumY[j];
+            c += partials[t].count[j];
+        }
+        if(c == 0) continue;    // empty cluster: the centroid stays where it is
+        double nx = sx / c, ny = sy / c;
+        moved[j] = sqrt((nx - cx[j])*(nx - cx[j]) + (ny - cy[j])*(ny - cy[j]));
+        cx[j] = nx;
+        cy[j] = ny;
+        if(moved[j] > maxMoved){
+            maxMoved2 = maxMoved;
+            maxMoved = moved[j];
+            maxMovedIdx = j;
+        }
+        else if(moved[j] > maxMoved2)
+            maxMoved2 = moved[j];
+    }
+    return changed == 0 || maxMoved == 0;
+}
+
+void KMeans::updateSeparation()
+{
+    // the closest other centroid is the second closest to the centroid itself
+    unsigned int k = cx.size();
+    s.resize(k);
+    for(unsigned int j = 0; j < k; j++){
+        int best;
+        double d1, d2;
+        nearestTwo(cx[j], cy[j], best, d1, d2);
+        s[j] = 0.5 * d2;
+    }
+}
+
+void KMeans::run(const double *x, const double *y, unsigned int n, unsigned int k, int maxIter)
+{
+    iterations = 0;
+    assignment.assign(n, 0);
+    if(n == 0 || k == 0) return;
+    if(k > n) k = n;
+    seed(x, y, n, k);
+    buildGrid();
+    upper.resize(n);
+    lower.resize(n);
+
+    forEachChunk(n, &KMeans::initBounds, x, y);
+    for(iterations = 1; ; iterations++){
+        if(updateCentroids() || iterations >= maxIter) break;
+        buildGrid();
+        updateSeparation();
+        forEachChunk(n, &KMeans::assign, x, y);
+    }
+}
@@ -0,0 +1,104 @@
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with this program.  If not, see http://www.gnu.org/licenses/.
+//
+
+#ifndef __IMPRO_LEACH_KMEANS_H_
+#define __IMPRO_LEACH_KMEANS_H_
+
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/**
+ * 2-d k-means with Hamerly's bounds: each point keeps an upper bound to its
+ * centroid and a lower bound to the second closest one, so most points skip
+ * the distance computations once the centroids stop moving much. The full
+ * searches left go through a uniform grid over the centroids.
+ *
+ * Centroids are kept between calls and used as the starting point of the
+ * next one (warm start); missing centroids are taken from evenly strided
+ * points, so the solver does not draw from the simulation RNGs.
+ *
+ * With more than one thread the passes over the points are split in chunks;
+ * the caller runs the first one and a pool of workers, started on first use
+ * and kept for the lifetime of the object, runs the others.
+ */
+class KMeans
+{
+  private:
+    struct Partial
+    {
+        std::vector<double> sumX, sumY;
+        std::vector<unsigned int> count;
+        unsigned int changed;
+    };
+
+    std::vector<double> cx, cy;     // centroids
+    std::vector<double> s;          // half distance to the closest other centroid
+    std::vector<double> moved;      // centroid movement in the last update
+    double maxMoved = 0, maxMoved2 = 0; // largest and second largest movement
+    int maxMovedIdx = -1;
+    std::vector<int> assignment;
+    std::vector<double> upper, lower;
+    std::vector<Partial> partials;  // one per thread
+    unsigned int threads = 1;
+    unsigned int chunks = 1;        // threads used by the last pass
+    int iterations = 0;
+    // grid over the centroids for the full nearest searches
+    double gridX0, gridY0, cell;
+    int gridW, gridH;
+    std::vector<int> cellBegin, cellItems;
+    // worker pool; the current pass is published under the lock with a new generation
+    typedef void (KMeans::*ChunkFn)(const double *, const double *, unsigned int, unsigned int, Partial &);
+    std::vector<std::thread> workers;
+    std::mutex lock;
+    std::condition_variable started, finished;
+    unsigned long generation = 0;
+    unsigned int pending = 0;       // chunks of the current pass not finished yet
+    bool stopping = false;
+    ChunkFn jobFn = nullptr;
+    const double *jobX = nullptr, *jobY = nullptr;
+    unsigned int jobN = 0, jobSize = 0;
+
+    int cellOf(double px, double py) const { return (int) ((py - gridY0) / cell) * gridW + (int) ((px - gridX0) / cell); }
+    void seed(const double *x, const double *y, unsigned int n, unsigned int k);
+    void buildGrid();
+    void nearestTwo(double px, double py, int &best, double &d1, double &d2) const;
+    void initBounds(const double *x, const double *y, unsigned int lo, unsigned int hi, Partial &p);
+    void assign(const double *x, const double *y, unsigned int lo, unsigned int hi, Partial &p);
+    bool updateCentroids();
+    void updateSeparation();
+    void forEachChunk(unsigned int n, ChunkFn f, const double *x, const double *y);
+    void runChunk(unsigned int t);
+    void workerLoop(unsigned int t);
+
+  public:
+    KMeans() {}
+    KMeans(const KMeans &) = delete;
+    KMeans &operator=(const KMeans &) = delete;
+    ~KMeans();
+
+    void setThreads(unsigned int n) { threads = n > 0 ? n : 1; }
+    void run(const double *x, const double *y, unsigned int n, unsigned int k, int maxIter = 100);
+    void clear() { cx.clear(); cy.clear(); }
+
+    unsigned int getK() const { return cx.size(); }
+    double getCX(unsigned int j) const { return cx[j]; }
+    double getCY(unsigned int j) const { return cy[j]; }
+    int getCluster(unsigned int i) const { return assignment[i]; }
+    int getIterations() const { return iterations; }
+};
+
+#endif
@@ -0,0 +1,123 @@
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with this program.  If not, see http://www.gnu.org/licenses/.
+//
+
+#include <algorithm>
+#include <functional>
+#include "lifetime.h"
+
+void RunMoments::collect(double v)
+{
+    if(n == 0 || v < min) min = v;
+    if(n == 0 || v > max) max = v;
+    n++;
+    sum += v;
+    sumSq += v*v;
+}
+
+void LifetimeStats::setFractions(const std::vector<double> &f)
+{
+    fractions = f;
+    std::sort(fractions.begin(), fractions.end(), std::greater<double>());
+    roundsToFraction.assign(fractions.size(), -1);
+    mRoundsToFraction.resize(fractions.size());
+    nextFraction = 0;
+}
+
+void LifetimeStats::addNode(double initial, double residual, int deathRound)
+{
+    N++;
+    initialEnergy += initial;
+    if(deathRound < 0){
+        alive++;
+        add(residual);
+    }
+    else
+        deaths.push_back(deathRound);
+}
+
+void LifetimeStats::resume(int round)
+{
+    // deaths of the warm-up run, in the order they happened
+    std::sort(deaths.begin(), deaths.end());
+    unsigned int dead = deaths.size();
+    if(dead > 0) FND = deaths[0];
+    if(2*dead >= N && dead > 0) HND = deaths[(N + 1)/2 - 1];
+    if(alive == 0 && dead > 0) LND = deaths[dead - 1];
+    deaths.clear();
+    // thresholds already crossed were crossed by the last round of the warm-up at the latest
+    while((nextFraction < fractions.size()) && (residualEnergy < fractions[nextFraction]*initialEnergy)){
+        roundsToFraction[nextFraction] = round - 1;
+        nextFraction++;
+    }
+}
+
+void LifetimeStats::add(double v)
+{
+    // compensated, so that millions of small costs do not drift the sum
+    double y = v - residualComp;
+    double t = residualEnergy + y;
+    residualComp = (t - residualEnergy) - y;
+    residualEnergy = t;
+}
+
+void LifetimeStats::energySpent(double cost, int round)
+{
+    add(-cost);
+    // thresholds are sorted, so each event checks only the next one
+    while((nextFraction < fractions.size()) && (residualEnergy < fractions[nextFraction]*initialEnergy)){
+        roundsToFraction[nextFraction] = round;
+        nextFraction++;
+    }
+}
+
+void LifetimeStats::nodeDied(double residual, int round)
+{
+    // the energy left in a dead node cannot be used anymore
+    energySpent(residual, round);
+    alive--;
+    unsigned int dead = N - alive;
+    if(FND < 0) FND = round;
+    if(2*dead >= N && HND < 0) HND = round;
+    if(alive == 0) LND = round;
+}
+
+void LifetimeStats::endRound(int round)
+{
+    if(round < 0) return;
+    if(aliveSum.size() <= (unsigned int) round)
+        aliveSum.resize(round+1, 0);
+    aliveSum[round] += alive;
+}
+
+void LifetimeStats::endRun()
+{
+    if(FND >= 0) mFND.collect(FND);
+    if(HND >= 0) mHND.collect(HND);
+    if(LND >= 0) mLND.collect(LND);
+    for(unsigned int i = 0; i < roundsToFraction.size(); i++)
+        if(roundsToFraction[i] >= 0) mRoundsToFraction[i].collect(roundsToFraction[i]);
+    runs++;
+}
+
+void LifetimeStats::resetRun()
+{
+    // keep the merged results and the thresholds, start a new run
+    N = alive = 0;
+    initialEnergy = residualEnergy = residualComp = 0;
+    FND = HND = LND = -1;
+    roundsToFraction.assign(fractions.size(), -1);
+    nextFraction = 0;
+    deaths.clear();
+}
@@ -0,0 +1,101 @@
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with this program.  If not, see http://www.gnu.org/licenses/.
+//
+
+#ifndef __IMPRO_LEACH_LIFETIME_H_
+#define __IMPRO_LEACH_LIFETIME_H_
+
+#include <vector>
+
+/**
+ * Running moments of a per-run metric over the runs.
+ */
+struct RunMoments
+{
+    unsigned long n = 0;
+    double sum = 0, sumSq = 0;
+    double min = 0, max = 0;
+
+    void collect(double v);
+    double mean() const { return n ? sum / n : -1; }
+};
+
+/**
+ * Network lifetime metrics, updated in O(1) per energy event.
+ *
+ * Tracks first/half/last node dead (FND/HND/LND), the round in which the
+ * total residual energy of the network drops below each configured fraction
+ * of the initial energy, and the number of alive nodes at the end of each
+ * round. The runs of warm repetitions are accumulated by endRun(): moments
+ * of the per-run metrics, and the alive nodes of each round summed over runs.
+ *
+ * The residual energy and alive count also give energy-aware elections the
+ * network average without any scan.
+ *
+ * A run resumed from a snapshot adds its nodes with their death rounds, then
+ * resume() sets the metrics the warm-up run already reached.
+ */
+class LifetimeStats
+{
+  private:
+    // current run
+    unsigned int N = 0;         // nodes in the network
+    unsigned int alive = 0;     // nodes still alive
+    double initialEnergy = 0;   // sum of the initial energy of all nodes
+    double residualEnergy = 0;  // sum of the energy of alive nodes
+    double residualComp = 0;    // compensation of the rounding error of residualEnergy (Kahan)
+    int FND = -1, HND = -1, LND = -1;
+    std::vector<double> fractions;      // residual energy thresholds, decreasing
+    std::vector<int> roundsToFraction;  // first round below each threshold (-1: not reached)
+    unsigned int nextFraction = 0;      // first threshold not reached yet
+    std::vector<int> deaths;            // death rounds of the nodes added dead (resumed runs)
+
+    // all the runs
+    RunMoments mFND, mHND, mLND;
+    std::vector<RunMoments> mRoundsToFraction;
+    std::vector<double> aliveSum;       // alive nodes at the end of round r, summed over runs
+    unsigned long runs = 0;
+
+    void add(double v);
+
+  public:
+    void setFractions(const std::vector<double> &f);
+    void addNode(double initial, double residual, int deathRound = -1);
+    void resume(int round);
+    void energySpent(double cost, int round);
+    void nodeDied(double residual, int round);
+    void endRound(int round);
+    void endRun();
+    void resetRun();
+
+    unsigned int getAlive() const { return alive; }
+    unsigned int getN() const { return N; }
+    double getResidualEnergy() const { return residualEnergy; }
+    double getAverageEnergy() const { return alive ? residualEnergy / alive : 0; }
+    double getInitialEnergy() const { return initialEnergy; }
+    int getFND() const { return FND; }
+    int getHND() const { return HND; }
+    int getLND() const { return LND; }
+    const std::vector<double>& getFractions() const { return fractions; }
+    int getRoundsToFraction(unsigned int i) const { return roundsToFraction.at(i); }
+
+    unsigned long getRuns() const { return runs; }
+    const RunMoments& getMergedFND() const { return mFND; }
+    const RunMoments& getMergedHND() const { return mHND; }
+    const RunMoments& getMergedLND() const { return mLND; }
+    const RunMoments& getMergedRoundsToFraction(unsigned int i) const { return mRoundsToFraction.at(i); }
+    const std::vector<double>& getAliveSum() const { return aliveSum; }
+};
+
+#endif
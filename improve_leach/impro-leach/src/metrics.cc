@@ -0,0 +1,82 @@
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with this program.  If not, see http://www.gnu.org/licenses/.
+//
+
+#include <cstring>
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+#include "metrics.h"
+
+bool MetricsRing::open(const char *fileName, unsigned int numSlots, const char *runId)
+{
+    close();
+#ifdef _WIN32
+    return false;
+#else
+    unsigned int n = 1;
+    while(n < numSlots)
+        n <<= 1;
+    size_t bytes = sizeof(MetricsHeader) + (size_t) n * sizeof(MetricsSlot);
+    int fd = ::open(fileName, O_RDWR | O_CREAT, 0644);
+    if(fd < 0) return false;
+    void *base = ftruncate(fd, bytes) == 0 ? mmap(nullptr, bytes, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0) : MAP_FAILED;
+    ::close(fd);
+    if(base == MAP_FAILED) return false;
+
+    // readers ignore the ring until the magic is back
+    header = (MetricsHeader *) base;
+    slots = (MetricsSlot *) (header + 1);
+    length = bytes;
+    memset(header->magic, 0, sizeof(header->magic));
+    for(unsigned int i = 0; i < n; i++)
+        slots[i].seq.store(0, std::memory_order_relaxed);
+    header->version = METRICS_VERSION;
+    header->slots = n;
+    strncpy(header->run, runId, sizeof(header->run) - 1);
+    header->run[sizeof(header->run) - 1] = 0;
+    std::atomic_thread_fence(std::memory_order_release);
+    memcpy(header->magic, METRICS_MAGIC, sizeof(header->magic));
+    published = 0;
+    return true;
+#endif
+}
+
+void MetricsRing::close()
+{
+#ifndef _WIN32
+    if(header) munmap(header, length);
+#endif
+    header = nullptr;
+    slots = nullptr;
+}
+
+void MetricsRing::publish(int round, unsigned int alive, double residualEnergy, unsigned int clusterHeads,
+        double simTime, double eventsPerSec, double wallTime)
+{
+    MetricsSlot &s = slots[published & (header->slots - 1)];
+    published++;
+    s.seq.store(2*published - 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    s.round = round;
+    s.alive = alive;
+    s.residualEnergy = residualEnergy;
+    s.clusterHeads = clusterHeads;
+    s.simTime = simTime;
+    s.eventsPerSec = eventsPerSec;
+    s.wallTime = wallTime;
+    s.seq.store(2*published, std::memory_order_release);
+}
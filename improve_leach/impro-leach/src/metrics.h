@@ -0,0 +1,82 @@
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with this program.  If not, see http://www.gnu.org/licenses/.
+//
+
+#ifndef __IMPRO_LEACH_METRICS_H_
+#define __IMPRO_LEACH_METRICS_H_
+
+#include <atomic>
+#include <cstdint>
+#include <cstddef>
+
+#define METRICS_MAGIC "LEACHMET"
+#define METRICS_VERSION 1
+
+/**
+ * Metrics of one round, one cache line of the shared ring.
+ *
+ * seq is 2*(k+1) once the k-th round published is complete and odd while
+ * it is being written (seqlock): a reader copies the slot and accepts it
+ * if seq was even and the same before and after the copy.
+ */
+struct MetricsSlot
+{
+    std::atomic<uint64_t> seq;
+    int32_t round;
+    uint32_t alive;             // nodes alive at the end of the round
+    double residualEnergy;      // J, all the nodes
+    uint32_t clusterHeads;      // elected in the round
+    uint32_t reserved;
+    double simTime;             // s, end of the round
+    double eventsPerSec;        // over the round, wall clock
+    double wallTime;            // s spent on the round
+    char pad[8];
+};
+
+static_assert(sizeof(MetricsSlot) == 64, "a metrics slot must fill one cache line");
+
+// start of the mapping, followed by the slots
+struct MetricsHeader
+{
+    char magic[8];
+    uint32_t version;
+    uint32_t slots;
+    char run[112];              // run id, to notice a new run
+};
+
+/**
+ * Writer of the metrics ring: a file of a MetricsHeader and a power of two
+ * of MetricsSlots, mapped shared (put it in /dev/shm for memory only).
+ * publish() writes one slot; readers (tools/leachtop) poll the slots and
+ * never block the writer. The file is left in place when closed.
+ */
+class MetricsRing
+{
+  private:
+    MetricsHeader *header = nullptr;
+    MetricsSlot *slots = nullptr;
+    size_t length = 0;
+    uint64_t published = 0;
+
+  public:
+    ~MetricsRing() { close(); }
+    // false if the file cannot be created or mapped
+    bool open(const char *fileName, unsigned int numSlots, const char *runId);
+    void close();
+    bool isOpen() const { return header != nullptr; }
+    void publish(int round, unsigned int alive, double residualEnergy, unsigned int clusterHeads,
+            double simTime, double eventsPerSec, double wallTime);
+};
+
+#endif
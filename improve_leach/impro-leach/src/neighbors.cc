@@ -0,0 +1,123 @@
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with this program.  If not, see http://www.gnu.org/licenses/.
+//
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include "neighbors.h"
+
+#define NEIGHBORS_CELLS_PER_NODE 4 // upper bound of grid cells per node, for very short ranges
+
+void NeighborGraph::build(const double *x, const double *y, unsigned int n, double r)
+{
+    range = r;
+    dead.assign(n, 0);
+    alive.resize(n);
+    stale = 0;
+    for(unsigned int i = 0; i < n; i++)
+        alive[i] = i;
+    rowBegin.assign(n, 0);
+    rowSize.assign(n, 0);
+    adj.clear();
+    if(n == 0) return;
+
+    double minX = x[0], maxX = x[0], minY = y[0], maxY = y[0];
+    for(unsigned int i = 1; i < n; i++){
+        minX = std::min(minX, x[i]); maxX = std::max(maxX, x[i]);
+        minY = std::min(minY, y[i]); maxY = std::max(maxY, y[i]);
+    }
+    double w = maxX - minX, h = maxY - minY;
+    complete = range*range >= w*w + h*h;
+    if(complete) return;
+
+    // cells of at least range: the neighbors of a node are in the 3x3 cells around it
+    double cell = std::max(range, sqrt(w*h / (NEIGHBORS_CELLS_PER_NODE * (double) n)));
+    int nx = (int) (w / cell) + 1, ny = (int) (h / cell) + 1;
+    std::vector<int> cellOf(n), cellBegin(nx*ny + 1, 0), order(n);
+    for(unsigned int i = 0; i < n; i++){
+        int cx = (int) ((x[i] - minX) / cell), cy = (int) ((y[i] - minY) / cell);
+        cellOf[i] = cy*nx + cx;
+        cellBegin[cellOf[i] + 1]++;
+    }
+    for(int c = 0; c < nx*ny; c++)
+        cellBegin[c+1] += cellBegin[c];
+    std::vector<int> fill(cellBegin.begin(), cellBegin.end() - 1);
+    for(unsigned int i = 0; i < n; i++)
+        order[fill[cellOf[i]]++] = i; // ascending ids within a cell
+
+    // rows in cell order
+    double range2 = range*range;
+    for(unsigned int k = 0; k < n; k++){
+        int i = order[k];
+        int cx = cellOf[i] % nx, cy = cellOf[i] / nx;
+        rowBegin[i] = adj.size();
+        for(int gy = std::max(0, cy-1); gy <= std::min(ny-1, cy+1); gy++){
+            for(int gx = std::max(0, cx-1); gx <= std::min(nx-1, cx+1); gx++){
+                int c = gy*nx + gx;
+                for(int m = cellBegin[c]; m < cellBegin[c+1]; m++){
+                    int j = order[m];
+                    double dx = x[i] - x[j], dy = y[i] - y[j];
+                    if(j != i && dx*dx + dy*dy <= range2)
+                        adj.push_back(j);
+                }
+            }
+        }
+        rowSize[i] = adj.size() - rowBegin[i];
+        std::sort(adj.begin() + rowBegin[i], adj.end());
+    }
+}
+
+void NeighborGraph::erase(int *row, int &size, int id)
+{
+    int *pos = std::lower_bound(row, row + size, id);
+    if(pos == row + size || *pos != id) return;
+    memmove(pos, pos + 1, (row + size - pos - 1) * sizeof(int));
+    size--;
+}
+
+void NeighborGraph::remove(int id)
+{
+    if(dead[id]) return;
+    dead[id] = 1;
+    if(complete){
+        // compact only when most of the list is dead, so that deaths cost O(1) amortized
+        if(2*++stale > alive.size()){
+            alive.erase(std::remove_if(alive.begin(), alive.end(), [this](int i) { return dead[i] != 0; }), alive.end());
+            stale = 0;
+        }
+        return;
+    }
+    for(int k = rowBegin[id]; k < rowBegin[id] + rowSize[id]; k++){
+        int j = adj[k];
+        erase(adj.data() + rowBegin[j], rowSize[j], id);
+    }
+    rowSize[id] = 0;
+}
+
+unsigned int NeighborGraph::getDegree(int id) const
+{
+    if(complete) return dead[id] ? alive.size() - stale : alive.size() - stale - 1;
+    return rowSize[id];
+}
+
+double NeighborGraph::getMeanDegree() const
+{
+    if(alive.size() == stale) return 0;
+    if(complete) return alive.size() - stale - 1;
+    double sum = 0;
+    for(unsigned int i = 0; i < alive.size(); i++)
+        sum += rowSize[alive[i]];
+    return sum / alive.size();
+}
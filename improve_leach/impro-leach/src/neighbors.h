@@ -0,0 +1,86 @@
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with this program.  If not, see http://www.gnu.org/licenses/.
+//
+
+#ifndef __IMPRO_LEACH_NEIGHBORS_H_
+#define __IMPRO_LEACH_NEIGHBORS_H_
+
+#include <cstdint>
+#include <vector>
+
+/**
+ * Alive nodes within radio range of each node, as a CSR adjacency graph.
+ *
+ * Built once per deployment with a uniform grid of range-sized cells, so
+ * only the 3x3 cells around a node are checked. Rows are stored in
+ * grid-cell order (nodes close in the field are close in memory) and the
+ * ids of a row are ascending, i.e. the order of the former loops over all
+ * the nodes. Dead nodes are removed from the rows of their neighbors.
+ *
+ * If the range covers the whole field every row would hold all the nodes:
+ * the rows are then not stored and all of them are the list of alive nodes,
+ * which contains the node itself. Deaths only mark the node in the dead
+ * bitmap, the list is compacted once most of it is dead, and iterations
+ * skip the dead ids left in it.
+ */
+class NeighborGraph
+{
+  public:
+    // ids of a row, skipping the dead ones
+    class Iterator
+    {
+      private:
+        const int *p, *e;
+        const uint8_t *dead;
+        void skip() { while(p != e && dead[*p]) p++; }
+      public:
+        Iterator(const int *p, const int *e, const uint8_t *dead) : p(p), e(e), dead(dead) { skip(); }
+        int operator*() const { return *p; }
+        Iterator &operator++() { p++; skip(); return *this; }
+        Iterator operator++(int) { Iterator i = *this; ++*this; return i; }
+        bool operator!=(const Iterator &o) const { return p != o.p; }
+        bool operator==(const Iterator &o) const { return p == o.p; }
+    };
+
+  private:
+    double range = 0;
+    bool complete = false;          // every node is in range of every other
+    std::vector<int> rowBegin;      // CSR row of each node id in adj
+    std::vector<int> rowSize;       // alive neighbors in the row
+    std::vector<int> adj;           // neighbor ids
+    std::vector<int> alive;         // alive ids, ascending (rows of the complete graph), and the stale dead ones
+    unsigned int stale = 0;         // dead ids still in alive
+    std::vector<uint8_t> dead;
+
+    static void erase(int *row, int &size, int id);
+    const int *rowFirst(int id) const { return complete ? alive.data() : adj.data() + rowBegin[id]; }
+    const int *rowLast(int id) const { return complete ? alive.data() + alive.size() : adj.data() + rowBegin[id] + rowSize[id]; }
+
+  public:
+    void build(const double *x, const double *y, unsigned int n, double range);
+    void remove(int id);
+
+    unsigned int size() const { return dead.size(); }
+    bool isComplete() const { return complete; }
+    bool isAlive(int id) const { return !dead[id]; }
+    double getRange() const { return range; }
+
+    // alive ids in range of the node; in a complete graph the node itself is included
+    Iterator begin(int id) const { return Iterator(rowFirst(id), rowLast(id), dead.data()); }
+    Iterator end(int id) const { return Iterator(rowLast(id), rowLast(id), dead.data()); }
+    unsigned int getDegree(int id) const;
+    double getMeanDegree() const;
+};
+
+#endif
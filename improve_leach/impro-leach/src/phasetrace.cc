@@ -0,0 +1,100 @@
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with this program.  If not, see http://www.gnu.org/licenses/.
+//
+
+
+#include "phasetrace.h"
+#include "common.h"
+
+using namespace omnetpp;
+
+#define PHASE_BUFFER 65536      // bytes buffered before a write
+
+void PhaseTrace::open(const char *fileName)
+{
+    close();
+    f = fopen(fileName, "w");
+    if(!f) throw cRuntimeError("Cannot create phase trace '%s'", fileName);
+    buf.reserve(PHASE_BUFFER + 512);
+    buf = "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n";
+    first = true;
+    named.clear();
+    events = 0;
+}
+
+void PhaseTrace::close()
+{
+    if(!f) return;
+    buf += "\n]}\n";
+    fwrite(buf.data(), 1, buf.size(), f); // also from the destructor: no throw
+    buf.clear();
+    fclose(f);
+    f = nullptr;
+}
+
+void PhaseTrace::flush()
+{
+    if(fwrite(buf.data(), 1, buf.size(), f) != buf.size())
+        throw cRuntimeError("Cannot write phase trace");
+    buf.clear();
+}
+
+void PhaseTrace::name(int cluster, int node)
+{
+    // metadata events the first time a track is used
+    char line[160];
+    int pid = cluster + 1;
+    if(named.insert(std::make_pair(cluster, -2)).second){
+        if(cluster < 0)
+            sprintf(line, "%s{\"ph\":\"M\",\"name\":\"process_name\",\"pid\":%d,\"args\":{\"name\":\"BS\"}}", first ? "" : ",\n", pid);
+        else
+            sprintf(line, "%s{\"ph\":\"M\",\"name\":\"process_name\",\"pid\":%d,\"args\":{\"name\":\"cluster %d\"}}", first ? "" : ",\n", pid, cluster);
+        buf += line;
+        sprintf(line, ",\n{\"ph\":\"M\",\"name\":\"process_sort_index\",\"pid\":%d,\"args\":{\"sort_index\":%d}}", pid, pid);
+        buf += line;
+        first = false;
+    }
+    if(named.insert(std::make_pair(cluster, node)).second){
+        if(node < 0)
+            sprintf(line, ",\n{\"ph\":\"M\",\"name\":\"thread_name\",\"pid\":%d,\"tid\":%d,\"args\":{\"name\":\"BS\"}}", pid, node);
+        else
+            sprintf(line, ",\n{\"ph\":\"M\",\"name\":\"thread_name\",\"pid\":%d,\"tid\":%d,\"args\":{\"name\":\"%s %d\"}}",
+                    pid, node, node == cluster ? "CH" : "node", node);
+        buf += line;
+    }
+}
+
+void PhaseTrace::event(const char *name, char ph, int cluster, int node, double t, double dur, int round)
+{
+    if(!f) return;
+    this->name(cluster, node);
+    char line[256];
+    int n = sprintf(line, ",\n{\"name\":\"%s\",\"ph\":\"%c\",\"pid\":%d,\"tid\":%d,\"ts\":%.3f", name, ph, cluster + 1, node, t * 1e6);
+    if(ph == 'X') n += sprintf(line + n, ",\"dur\":%.3f", dur * 1e6);
+    else n += sprintf(line + n, ",\"s\":\"t\"");
+    sprintf(line + n, ",\"args\":{\"round\":%d}}", round);
+    buf += line;
+    events++;
+    if(buf.size() >= PHASE_BUFFER) flush();
+}
+
+void PhaseTrace::span(const char *name, int cluster, int node, double begin, double end, int round)
+{
+    event(name, 'X', cluster, node, begin, end > begin ? end - begin : 0, round);
+}
+
+void PhaseTrace::instant(const char *name, int cluster, int node, double t, int round)
+{
+    event(name, 'i', cluster, node, t, 0, round);
+}
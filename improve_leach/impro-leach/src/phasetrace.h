@@ -0,0 +1,63 @@
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with this program.  If not, see http://www.gnu.org/licenses/.
+//
+
+
+#ifndef __IMPRO_LEACH_PHASETRACE_H_
+#define __IMPRO_LEACH_PHASETRACE_H_
+
+#include <cstdio>
+#include <set>
+#include <string>
+#include <utility>
+
+/**
+ * Phases of the rounds in simulated time, as a Chrome trace / Perfetto JSON
+ * file ("traceEvents" array, open it in ui.perfetto.dev or chrome://tracing).
+ *
+ * Each cluster is a process (named after its CH, cluster and node -1 are
+ * the BS) and each node a thread of the cluster it works for: the CH track shows
+ * election, ADV window, JOIN window, SCHED, TDMA frame, aggregation and BS
+ * upload, the member tracks their TDMA slot. Times are simulated seconds,
+ * written in us. Events are appended to a buffer that is written out when
+ * full, so the file grows with the run instead of being kept in memory.
+ */
+class PhaseTrace
+{
+  private:
+    FILE *f = nullptr;
+    std::string buf;
+    bool first = true;          // no comma before the first event
+    std::set<std::pair<int, int> > named; // (cluster, node) with a name event
+    unsigned long events = 0;
+
+    void name(int cluster, int node);
+    void event(const char *name, char ph, int cluster, int node, double t, double dur, int round);
+    void flush();
+
+  public:
+    ~PhaseTrace() { close(); }
+
+    // throws if the file cannot be created
+    void open(const char *fileName);
+    void close();
+    bool isOpen() const { return f != nullptr; }
+
+    void span(const char *name, int cluster, int node, double begin, double end, int round);
+    void instant(const char *name, int cluster, int node, double t, int round);
+
+    unsigned long getEvents() const { return events; }
+};
+
+#endif
@@ -0,0 +1,89 @@
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with this program.  If not, see http://www.gnu.org/licenses/.
+//
+
+
+#include <algorithm>
+#include "radio.h"
+
+void RadioState::setPower(double sleep, double listen, double rx, double tx)
+{
+    power[RADIO_SLEEP] = sleep;
+    power[RADIO_LISTEN] = listen;
+    power[RADIO_RX] = rx;
+    power[RADIO_TX] = tx;
+}
+
+void RadioState::reset(double t)
+{
+    mode = RADIO_SLEEP;
+    since = t;
+    planned.clear();
+    spent = 0;
+    std::fill(time, time + RADIO_MODES, 0.0);
+}
+
+void RadioState::advance(double t)
+{
+    unsigned int k = 0;
+    for(; k < planned.size() && planned[k].t <= t; k++){
+        if(planned[k].t > since){
+            time[mode] += planned[k].t - since;
+            spent += power[mode] * (planned[k].t - since);
+            since = planned[k].t;
+        }
+        mode = planned[k].mode;
+    }
+    planned.erase(planned.begin(), planned.begin() + k);
+    if(t > since){
+        time[mode] += t - since;
+        spent += power[mode] * (t - since);
+        since = t;
+    }
+}
+
+void RadioState::set(double t, radioMode m)
+{
+    advance(t);
+    planned.clear();
+    mode = m;
+}
+
+void RadioState::plan(double t, radioMode m)
+{
+    Change c;
+    c.t = t;
+    c.mode = m;
+    // usually the latest one
+    std::vector<Change>::iterator it = planned.end();
+    while(it != planned.begin() && (it - 1)->t > t)
+        --it;
+    planned.insert(it, c);
+}
+
+void RadioState::burst(radioMode m, double duration)
+{
+    // in place of the same time in the current mode, integrated before or after
+    time[m] += duration;
+    time[mode] -= duration;
+    spent += (power[m] - power[mode]) * duration;
+}
+
+double RadioState::take(double t)
+{
+    advance(t);
+    double e = std::max(0.0, spent); // bursts at less than the mode power are refunded from what follows
+    spent -= e;
+    return e;
+}
@@ -0,0 +1,70 @@
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with this program.  If not, see http://www.gnu.org/licenses/.
+//
+
+
+#ifndef __IMPRO_LEACH_RADIO_H_
+#define __IMPRO_LEACH_RADIO_H_
+
+#include <vector>
+
+enum radioMode {
+    RADIO_SLEEP,
+    RADIO_LISTEN,   // receiver on, nothing on the air
+    RADIO_RX,
+    RADIO_TX
+};
+#define RADIO_MODES 4
+
+/**
+ * Radio of a node as a state machine whose energy is integrated lazily: the
+ * time spent in each mode is accounted only when the mode changes (or the
+ * energy is taken), from the timestamp of the previous change, so no event
+ * is needed to follow the radio.
+ *
+ * Changes known in advance (e.g. waking up at the start of the TDMA frame)
+ * are planned and applied when the integration reaches them. Packets are
+ * short bursts in RX or TX inside the current mode: their duration is
+ * charged at the power of the burst instead of the one of the mode.
+ */
+class RadioState
+{
+  private:
+    struct Change
+    {
+        double t;
+        radioMode mode;
+    };
+    double power[RADIO_MODES] = { 0, 0, 0, 0 }; // W
+    radioMode mode = RADIO_SLEEP;
+    double since = 0;           // integrated up to here
+    std::vector<Change> planned; // in time order
+    double spent = 0;           // J not taken yet
+    double time[RADIO_MODES] = { 0, 0, 0, 0 }; // s in each mode
+
+  public:
+    void setPower(double sleep, double listen, double rx, double tx);
+    void reset(double t);       // asleep from t, statistics cleared
+    void advance(double t);     // integrate up to t
+    void set(double t, radioMode m); // change now, the planned changes are dropped
+    void plan(double t, radioMode m);
+    void burst(radioMode m, double duration);
+    double take(double t);      // energy spent up to t since the last take
+
+    radioMode getMode() const { return mode; }
+    double getPending() const { return spent; }
+    double getTime(radioMode m) const { return time[m]; }
+};
+
+#endif
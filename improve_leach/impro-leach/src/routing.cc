@@ -0,0 +1,161 @@
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with this program.  If not, see http://www.gnu.org/licenses/.
+//
+
+#include <algorithm>
+#include <cmath>
+#include <functional>
+#include <limits>
+#include "routing.h"
+
+void RoutingTree::setRadio(double eelec, double eamp, unsigned int k)
+{
+    Eelec = eelec;
+    Eamp = eamp;
+    bits = k;
+}
+
+double RoutingTree::hopCost(int from, int to) const
+{
+    double dx = x[from] - x[to], dy = y[from] - y[to];
+    return bits * (Eelec + Eamp * (dx*dx + dy*dy)) + bits * Eelec; // TX at the sender, RX at the relay
+}
+
+double RoutingTree::directCost(int n) const
+{
+    double dx = x[n] - bsX, dy = y[n] - bsY;
+    return bits * (Eelec + Eamp * (dx*dx + dy*dy));
+}
+
+double RoutingTree::getHopDist(int id) const
+{
+    int p = parent[id];
+    double dx = x[id] - (p < 0 ? bsX : x[p]), dy = y[id] - (p < 0 ? bsY : y[p]);
+    return sqrt(dx*dx + dy*dy);
+}
+
+void RoutingTree::link(int n, int p)
+{
+    parent[n] = p;
+    if(p < 0) return; // children of the BS are not needed
+    prevSibling[n] = -1;
+    nextSibling[n] = firstChild[p];
+    if(firstChild[p] >= 0) prevSibling[firstChild[p]] = n;
+    firstChild[p] = n;
+}
+
+void RoutingTree::unlink(int n)
+{
+    int p = parent[n];
+    if(p < 0) return;
+    if(prevSibling[n] >= 0) nextSibling[prevSibling[n]] = nextSibling[n];
+    else firstChild[p] = nextSibling[n];
+    if(nextSibling[n] >= 0) prevSibling[nextSibling[n]] = prevSibling[n];
+    prevSibling[n] = nextSibling[n] = -1;
+}
+
+void RoutingTree::relax(int n, int p, double c)
+{
+    if(c < cost[n]){
+        cost[n] = c;
+        parent[n] = p;
+        heap.push_back(std::make_pair(c, n));
+        std::push_heap(heap.begin(), heap.end(), std::greater<std::pair<double, int> >());
+    }
+}
+
+void RoutingTree::dijkstra()
+{
+    // pending nodes start with their direct cost (and best path through settled nodes) in the heap
+    std::greater<std::pair<double, int> > cmp;
+    while(!heap.empty()){
+        std::pop_heap(heap.begin(), heap.end(), cmp);
+        std::pair<double, int> top = heap.back();
+        heap.pop_back();
+        int v = top.second;
+        if(!pending[v] || top.first != cost[v]) continue; // stale entry
+        pending[v] = 0;
+        for(NeighborGraph::Iterator w = graph->begin(v); w != graph->end(v); w++)
+            if(*w != v && pending[*w])
+                relax(*w, v, cost[v] + hopCost(*w, v));
+    }
+}
+
+void RoutingTree::build(const NeighborGraph &g, const double *px, const double *py, double bx, double by)
+{
+    unsigned int n = g.size();
+    graph = &g;
+    x.assign(px, px + n);
+    y.assign(py, py + n);
+    bsX = bx;
+    bsY = by;
+    parent.assign(n, -1);
+    cost.assign(n, std::numeric_limits<double>::infinity());
+    firstChild.assign(n, -1);
+    nextSibling.assign(n, -1);
+    prevSibling.assign(n, -1);
+    pending.assign(n, 0);
+    heap.clear();
+    for(unsigned int i = 0; i < n; i++){
+        if(!g.isAlive(i)) continue;
+        pending[i] = 1;
+        cost[i] = directCost(i);
+        heap.push_back(std::make_pair(cost[i], (int) i));
+    }
+    std::make_heap(heap.begin(), heap.end(), std::greater<std::pair<double, int> >());
+    dijkstra();
+    for(unsigned int i = 0; i < n; i++)
+        if(g.isAlive(i)) link(i, parent[i]);
+    repaired = n;
+}
+
+void RoutingTree::remove(int id)
+{
+    if(parent.empty() || std::isinf(cost[id])) return;
+    unlink(id);
+
+    // nodes whose path went through id
+    subtree.clear();
+    for(int c = firstChild[id]; c >= 0; c = nextSibling[c])
+        subtree.push_back(c);
+    for(unsigned int k = 0; k < subtree.size(); k++)
+        for(int c = firstChild[subtree[k]]; c >= 0; c = nextSibling[c])
+            subtree.push_back(c);
+    firstChild[id] = -1;
+    parent[id] = -1;
+    cost[id] = std::numeric_limits<double>::infinity();
+
+    for(unsigned int k = 0; k < subtree.size(); k++){
+        int s = subtree[k];
+        firstChild[s] = nextSibling[s] = prevSibling[s] = -1;
+        parent[s] = -1;
+        cost[s] = directCost(s);
+        pending[s] = 1;
+    }
+
+    // best path of each of them through the rest of the tree, then Dijkstra inside the subtree
+    heap.clear();
+    for(unsigned int k = 0; k < subtree.size(); k++){
+        int s = subtree[k];
+        for(NeighborGraph::Iterator w = graph->begin(s); w != graph->end(s); w++)
+            if(*w != s && !pending[*w] && *w != id)
+                relax(s, *w, cost[*w] + hopCost(s, *w));
+        heap.push_back(std::make_pair(cost[s], s));
+        std::push_heap(heap.begin(), heap.end(), std::greater<std::pair<double, int> >());
+    }
+    dijkstra();
+    for(unsigned int k = 0; k < subtree.size(); k++)
+        link(subtree[k], parent[subtree[k]]);
+    repaired = subtree.size();
+}
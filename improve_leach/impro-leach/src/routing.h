@@ -0,0 +1,69 @@
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with this program.  If not, see http://www.gnu.org/licenses/.
+//
+
+#ifndef __IMPRO_LEACH_ROUTING_H_
+#define __IMPRO_LEACH_ROUTING_H_
+
+#include <cstdint>
+#include <utility>
+#include <vector>
+#include "neighbors.h"
+
+/**
+ * Minimum-energy paths from every node to the BS, as a tree rooted at the BS.
+ *
+ * A hop between nodes in range costs the energy to transmit k bits over its
+ * distance plus the energy to receive them (the radio model of
+ * Sensor::EnergyTX/EnergyRX); every node can also transmit directly to the
+ * BS, like in single-hop LEACH. The tree is computed with Dijkstra; when a
+ * node dies only its subtree is routed again, from the best paths of the
+ * nodes outside it (which cannot change, since costs only grow).
+ */
+class RoutingTree
+{
+  private:
+    double Eelec = 0, Eamp = 0;
+    unsigned int bits = 0;
+    double bsX = 0, bsY = 0;
+    const NeighborGraph *graph = nullptr;
+    std::vector<double> x, y;
+
+    std::vector<int> parent;        // next hop, -1 for the BS
+    std::vector<double> cost;       // energy to the BS
+    std::vector<int> firstChild, nextSibling, prevSibling;
+    std::vector<uint8_t> pending;   // in the subtree being routed again
+    std::vector<std::pair<double, int> > heap;
+    std::vector<int> subtree;
+    unsigned int repaired = 0;
+
+    double hopCost(int from, int to) const;
+    double directCost(int n) const;
+    void link(int n, int p);
+    void unlink(int n);
+    void relax(int n, int p, double c);
+    void dijkstra();
+
+  public:
+    void setRadio(double eelec, double eamp, unsigned int k);
+    void build(const NeighborGraph &g, const double *x, const double *y, double bsX, double bsY);
+    void remove(int id);
+
+    int getNextHop(int id) const { return parent[id]; }
+    double getHopDist(int id) const;
+    double getCost(int id) const { return cost[id]; }
+    unsigned int getRepaired() const { return repaired; }
+};
+
+#endif
@@ -14,6 +14,7 @@
 // 
 
 #include "sensor.h"
+#include "BS.h"
 #define DBL_MAX 1.7976931348623158e+308 /* max value */
 Define_Module(Sensor);
 
@@ -21,11 +22,14 @@ void Sensor::initialize()
 {
     // init parameters
     P = getParentModule()->par("P");
+    adaptiveP = getParentModule()->par("adaptiveP");
     id = this->getIndex(); // return the index of current module
     N = getParentModule()->par("Nnodes");
 
     double edge = getParentModule()->par("edge");
-    range = sqrt(2*pow(edge,2));
+    diagonal = sqrt(2*pow(edge,2));
+    range = getParentModule()->par("range");
+    if(range < 0) range = diagonal; // every node in range of every other
 
     bitrate = par("bitrate");
 
@@ -33,11 +37,46 @@ void Sensor::initialize()
     Eamp = this->par("Eamp");
     Ecomp = this->par("Ecomp");
     gamma = this->par("gamma");
+    radioStates = par("radioStates");
+    radio.setPower(par("sleepPower"), par("listenPower"), par("rxPower"), par("txPower"));
+    radio.reset(0);
 
     energy = this->par("energy");
+    initialEnergy = energy;
+    distAwareCH = par("DistAwareCH");
+    energyAwareCH = par("EnergyAwareCH");
     WATCH(energy);
 
     BS = getParentModule()->getSubmodule("baseStation");
+    lifetime = check_and_cast< ::BS *>(BS)->getLifetime();
+    chIndex = check_and_cast< ::BS *>(BS)->getCHIndex();
+    nodes = &check_and_cast< ::BS *>(BS)->getSensors();
+    neighbors = check_and_cast< ::BS *>(BS)->getNeighbors(); // built by the BS once all the nodes are deployed
+    routes = check_and_cast< ::BS *>(BS)->getRoutes();
+    channel = check_and_cast< ::BS *>(BS)->getChannel();
+    aggregator = check_and_cast< ::BS *>(BS)->getAggregator();
+    trace = check_and_cast< ::BS *>(BS)->getTrace();
+    phases = check_and_cast< ::BS *>(BS)->getPhaseTrace();
+    samplesPerReading = aggregator ? getParentModule()->par("samplesPerReading").intValue() : 0;
+    batchedSetup = getParentModule()->par("batchedSetup").boolValue() || getParentModule()->par("centralizedSetup").boolValue()
+            || getParentModule()->par("frameColoring").boolValue();
+
+    const char *lookup = par("chLookup");
+    if(!strcmp(lookup, "adv")) chLookup = LOOKUP_ADV;
+    else if(!strcmp(lookup, "index")) chLookup = LOOKUP_INDEX;
+    else if(!strcmp(lookup, "validate")) chLookup = LOOKUP_VALIDATE;
+    else throw cRuntimeError("Unknown chLookup '%s'", lookup);
+
+    const char *elect = getParentModule()->par("election");
+    election = ElectionStrategy::create(elect);
+    if(!election) throw cRuntimeError("Unknown election '%s'", elect);
+
+    // protocol variant (see LeachPolicy)
+    cModule *net = getParentModule();
+    bool adaptiveFrames = net->par("adaptiveFrames");
+    bool variant[] = { net->par("slotMaxDistInCluster").boolValue() || adaptiveFrames, net->par("useBSDist"), net->par("accountCHSetup"), net->par("oneTxPerRound") };
+    earlyRoundEnd = adaptiveFrames && net->par("oneTxPerRound").boolValue();
+    ops = PolicySelect<Ops, 4>::get(variant);
 
     // setup internal events
     startRound_e = new cMessage("start-round", START_ROUND);
@@ -47,6 +86,37 @@ void Sensor::initialize()
     rcvdData_e = new cMessage("received-DATA", RCVD_DATA);
     startTX_e = new cMessage("startTX", START_TX);
 
+    energySignal = registerSignal("energy");
+
+    // resume from the state saved by a warm-up run (see NetSnapshot)
+    const char *forkFile = getParentModule()->par("forkFile");
+    if(((int) getParentModule()->par("forkRound") < 0) && (strlen(forkFile) > 0))
+    {
+        std::shared_ptr<const NetSnapshot> snap = NetSnapshot::load(forkFile);
+        if(snap->nodes.size() != N)
+            throw cRuntimeError("Snapshot '%s' has %d nodes, expected %d", forkFile, (int) snap->nodes.size(), N);
+        restoreState(snap->nodes.at(id));
+        lifetime->addNode(initialEnergy, energy, role == DEAD ? deathRound : -1);
+        curRound = snap->round - 1;
+        par("round") = curRound;
+        radio.reset(snap->time);
+        if(role != DEAD && !batchedSetup)
+            scheduleAt(snap->time, startRound_e);
+        return;
+    }
+
+    deploy();
+
+    lifetime->addNode(energy, energy);
+
+    // in batched mode the BS runs the setup phase of every round
+    if(!batchedSetup)
+        scheduleAt(0,startRound_e);
+}
+
+void Sensor::deploy()
+{
+    double edge = getParentModule()->par("edge");
 
     // Setup position ֹλظ
     bool noRepeatPos = true;
@@ -67,10 +137,6 @@ void Sensor::initialize()
     // ²
     this->par("posX") = x;
     this->par("posY") = y;
-
-    energySignal = registerSignal("energy");
-
-    scheduleAt(0,startRound_e);
 }
 
 void Sensor::finish()
@@ -80,6 +146,38 @@ void Sensor::finish()
     cancelAndDelete(rcvdJoin_e);
     cancelAndDelete(rcvdData_e);
     cancelAndDelete(startTX_e);
+    delete election;
+    if(radioStates){
+        if(role != DEAD) radio.advance(simTime().dbl());
+        recordScalar("radioSleepTime", radio.getTime(RADIO_SLEEP));
+        recordScalar("radioListenTime", radio.getTime(RADIO_LISTEN));
+        recordScalar("radioRxTime", radio.getTime(RADIO_RX));
+        recordScalar("radioTxTime", radio.getTime(RADIO_TX));
+    }
+}
+
+void Sensor::fullReset()
+{
+    Enter_Method_Silent(); // called by the BS
+    // reset everything a new repetition on the same module tree needs
+    cancelEvent(startRound_e);
+    cancelEvent(rcvdSCHED_e);
+    for(unsigned int i = 0; i < msgBuf.size(); i++)
+        delete msgBuf[i];
+    reset();
+    energy = par("energy"); // volatile: a new battery for each repetition
+    initialEnergy = energy;
+    alreadyCH = false;
+    deathRound = -1;
+    roundTime = 0;
+    radio.reset(simTime().dbl());
+    curRound = -1;
+    par("round") = curRound;
+    getDisplayString().setTagArg("i2", 0, "");
+    deploy();
+    lifetime->addNode(energy, energy);
+    if(!batchedSetup)
+        scheduleAt(simTime(), startRound_e);
 }
 
 void Sensor::reset()
@@ -89,6 +187,8 @@ void Sensor::reset()
     msgBuf.clear();
     CH_id = -1;         // Cluster-Head id
     clusterN = 0;  // used by CH to keep track of the num. of nodes in the cluster
+    frameStart = 0;
+    frameOpen = false;
     cancelEvent(rcvdADV_e);
     cancelEvent(rcvdJoin_e);
     cancelEvent(rcvdData_e);
@@ -96,6 +196,12 @@ void Sensor::reset()
 
 }
 
+void Sensor::handleMessage(cMessage *msg)
+{
+    (this->*ops->handleMessage)(msg);
+}
+
+template<class Policy>
 void Sensor::handleMessage(cMessage *msg)
 {
     if(role != DEAD) // if the node is still alive, react to messages, otherwise just drop them
@@ -104,7 +210,7 @@ void Sensor::handleMessage(cMessage *msg)
         {
             case START_ROUND:
                 // start a new round in LEACH
-                selfElection(); // new election
+                selfElection<Policy>(); // new election
                 // schedule the next round after roundTime
                 scheduleAt(simTime()+roundTime,startRound_e);
                 break;
@@ -117,7 +223,7 @@ void Sensor::handleMessage(cMessage *msg)
 
             case RCVD_ADV:
                 // wake up after timeout to check received ADVs
-                chooseCH();
+                chooseCH<Policy>();
                 break;
 
             case SCHED_M:
@@ -126,25 +232,27 @@ void Sensor::handleMessage(cMessage *msg)
                 break;
 
             case START_TX:
-                sendData();
+                sendData<Policy>();
                 break;
 
             /******** CH cases *********/
             case JOIN_M:
+                radioBurst(RADIO_RX, JOIN_M_SIZE);
                 msgBuf.push_back(msg); // insert JOIN into the message buffer
                 break;
 
             case RCVD_JOIN:
                 // wake up after timeout to check received ADVs
                 if(msgBuf.size() > 0)
-                    createTXSched();
+                    createTXSched<Policy>();
                 else{
 
                     // if no JOIN/DATA has been received (i.e. no one joined or all nodes in the cluster died)
                     // just act as a normal node (i.e. Orphan)
+                    closeFrame(simTime().dbl());
                     reset();
                     //scheduleAt(simTime(), startTX_e);
-                    initOrphan();
+                    initOrphan<Policy>();
                 }
                 break;
 
@@ -153,7 +261,7 @@ void Sensor::handleMessage(cMessage *msg)
                 break;
 
             case RCVD_DATA:
-                compressAndSendToBS();
+                compressAndSendToBS<Policy>();
                 break;
 
             /********** alternative CH **************/
@@ -163,14 +271,20 @@ void Sensor::handleMessage(cMessage *msg)
                 alreadyCH = true;   // node excludes itself from next election
                 role = CH;
                 clusterN = ((mCenterCH *) msg)->getClusterN();
+                frameOpen = earlyRoundEnd; // frame handed over by the former CH
                 getDisplayString().setTagArg("i", 0, "old/ball2"); // UI feedback
                 // setup a timer to keep radio in IDLE mode and receive all data (TDMA)
                 // Timeout will take in account the propagation delay for SCHED msg to reach destination and to receive back all data sequentially
                 scheduleAt(simTime() + (((mCenterCH *) msg)->getSCHEDDelay()) + (((mCenterCH *) msg)->getIDLETime()) + EPSILON, rcvdData_e);
-                #ifdef ACCOUNT_CH_SETUP
-                // account for energy during IDLE time
-                EnergyMgmt(RX, 0, clusterN*DATA_M_SIZE);
-                #endif
+                if(phases) // frame handed over by the former CH
+                    phases->span("TDMA frame", id, id, (simTime() + ((mCenterCH *) msg)->getSCHEDDelay()).dbl(), rcvdData_e->getArrivalTime().dbl(), curRound);
+                setRadio(RADIO_SLEEP);
+                if(radioStates) // awake for the frame handed over
+                    radio.plan((simTime() + ((mCenterCH *) msg)->getSCHEDDelay()).dbl(), RADIO_LISTEN);
+                if(Policy::accountCHSetup){
+                    // account for energy during IDLE time
+                    EnergyMgmt(RX, 0, clusterN*DATA_M_SIZE);
+                }
                 break;
 
 
@@ -191,24 +305,31 @@ void Sensor::handleMessage(cMessage *msg)
 /******************* SENSOR functions **********************/
 double Sensor::T(unsigned int n)    // T(n) threshold function
 {
-    int r = par("round"); // get current round
+    int r = curRound; // get current round
 
-    if(!alreadyCH)
-        return P/(1-P*(r % 1/P));
-    else
-        return 0;
+    election->beginRound(r, P, *lifetime);
+    return election->threshold(energy, initialEnergy, alreadyCH);
 }
 
-void Sensor::selfElection()
+void Sensor::beginRound()
 {
-
-    int r = par("round"); // NOTE: par("round") starts at -1
-    par("round") = r+1;
-    if ((r+1) == 0) roundTime = getParentModule()->par("roundTime");
+    int r = curRound; // NOTE: par("round") starts at -1
+    curRound = r+1;
+    par("round") = curRound;
+    if (roundTime == 0) roundTime = getParentModule()->par("roundTime"); // first round of this run
+    if(adaptiveP) P = getParentModule()->par("P"); // already set by the BS for this round
     if(r+1 > 0) reset(); //reset all the structures before starting new round
+    setRadio(RADIO_LISTEN); // ADVs, or JOINs for a CH
 
-    r = par("round");
+    r = curRound;
     if((r % 1/P) == 0) alreadyCH = false; // reset current node status
+}
+
+template<class Policy>
+void Sensor::selfElection()
+{
+    beginRound();
+    if(role == DEAD) return; // the radio states of the last round took the rest of the battery
 
     //compute Threshold function
     double th = T(id);
@@ -218,20 +339,21 @@ void Sensor::selfElection()
         // self-elected as Cluster-Head (CH)
         //proceed to Advertisement Phase
         EV << "I am Cluster-Head!\n";
-        advertisementPhase();
+        advertisementPhase<Policy>();
     }
     else
     {
         // not CH.
         // start waiting for ADVs (consider max distance for timeout)
         scheduleAt(simTime() + propagationDelay(ADV_M_SIZE, MAX_DIST(range))+EPSILON, rcvdADV_e);
-#ifdef ACCOUNT_CH_SETUP  //ѡCHڷǷ
-        // add ENERGY CONSUMPTION FOR THE AMOUNT OF TIME WE ARE IN IDLE STATE
-        EnergyMgmt(RX, 0, ADV_M_SIZE);
-#endif
+        if(Policy::accountCHSetup){ //ѡCHڷǷ
+            // add ENERGY CONSUMPTION FOR THE AMOUNT OF TIME WE ARE IN IDLE STATE
+            EnergyMgmt(RX, 0, ADV_M_SIZE);
+        }
     }
 }
 
+template<class Policy>
 void Sensor::chooseCH()
 {
     CH_dist = std::numeric_limits<double>::infinity();//رdoubleֵ
@@ -247,9 +369,21 @@ void Sensor::chooseCH()
             CH_id = ADV->getId(); // select CH based on distance/RSSI
         }
         EV << "ADV received from " << ADV->getId() << " distance is " << dist << "\n";
+        radioBurst(RADIO_RX, ADV_M_SIZE);
         cancelAndDelete(ADV);
     }
 
+    if(chLookup != LOOKUP_ADV)
+    {
+        // nearest CH from the per-round index instead of (or in addition to) the ADVs
+        double dist = std::numeric_limits<double>::infinity();
+        int nearest = chIndex->nearest(curRound, x, y, MAX_DIST(range), dist);
+        if(chLookup == LOOKUP_VALIDATE && (nearest != CH_id || (nearest > -1 && dist != CH_dist)))
+            throw cRuntimeError("CH index returned node %d (distance %g), ADVs selected node %d (distance %g)", nearest, dist, CH_id, CH_dist);
+        CH_id = nearest;
+        CH_dist = dist;
+    }
+
     if(CH_id > -1){
         // CH has been chosen
         EV << "CH designed is " << CH_id << "\n";
@@ -261,46 +395,47 @@ void Sensor::chooseCH()
         JOIN->setId(id);
         cModule *CH = retrieveNode(CH_id);
         sendDirect(JOIN, delay, 0, CH->gate("in"));
-#ifdef ACCOUNT_CH_SETUP
-        // account for energy transmission based on distance
-        EnergyMgmt(TX, CH_dist, JOIN_M_SIZE);
-#endif
+        radioBurst(RADIO_TX, JOIN_M_SIZE);
+        if(Policy::accountCHSetup){
+            // account for energy transmission based on distance
+            EnergyMgmt(TX, CH_dist, JOIN_M_SIZE);
+        }
 
     } else {
 
         EV << "[ORPHAN NODE] No ADV has been received. \n";
 
-        initOrphan();//ʼ¶ڵ
+        initOrphan<Policy>();//ʼ¶ڵ
         //scheduleAt(simTime(), startTX_e);
     }
+    if(phases)
+        phases->span("ADV", phaseCluster(), id, rcvdADV_e->getSendingTime().dbl(), simTime().dbl(), curRound);
 }
 
+template<class Policy>
 void Sensor::initOrphan()
 {
     // set BS as CH
     CH_id = BS_ID;
-#ifdef USE_BS_DIST
-    CH_dist = BS_DIST(x,y);
-#else
-    CH_dist = MAX_DIST(range);
-#endif
+    CH_dist = bsDist<Policy>();
     // notify the BS that we are going to join it's cluster
     mJoin *JOIN = new mJoin("join-cluster", JOIN_M);
     double delay = propagationDelay(JOIN_M_SIZE, CH_dist);
     JOIN->setId(id);
     sendDirect(JOIN, delay, 0, BS->gate("in"));
-#ifdef ACCOUNT_CH_SETUP
-    // account for energy transmission based on distance
-    EnergyMgmt(TX, CH_dist, JOIN_M_SIZE);
-#endif
+    radioBurst(RADIO_TX, JOIN_M_SIZE);
+    if(Policy::accountCHSetup){
+        // account for energy transmission based on distance
+        EnergyMgmt(TX, CH_dist, JOIN_M_SIZE);
+    }
 }
 //ͨڵķʹؽڵ
 void Sensor::setupDataTX(mSchedule *SCHED){
 
-    int r = par("round");
+    int r = curRound;
     if(r == SCHED->getRound()){
 
-        if(par("DistAwareCH")){
+        if(distAwareCH){
             if(CH_id != SCHED->getCHId()){
                 CH_id = SCHED->getCHId();   // re-set the CH information if a better one has been designed by original CH
                 CH_dist = distance(CH_id);
@@ -309,15 +444,23 @@ void Sensor::setupDataTX(mSchedule *SCHED){
 
         // setup transmission time as the slot duration times my turn
         scheduleAt(simTime()+(SCHED->getDuration()*SCHED->getTurn()), startTX_e);
+        radioBurst(RADIO_RX, SCHED_M_SIZE);
+        setRadio(RADIO_SLEEP); // until our slot
         cancelAndDelete(SCHED);
     }
 
 }
 
+template<class Policy>
 void Sensor::sendData(){
     mData *DATA = new mData("data", DATA_M);
     DATA->setId(id);
-    DATA->setRound(par("round"));
+    DATA->setRound(curRound);
+    DATA->setCreated(simTime());
+    if(samplesPerReading > 0){
+        const float *samples = trace->read(id, x, y, curRound, samplesPerReading);
+        DATA->getSamples().assign(samples, samples + samplesPerReading);
+    }
     if(CH_id > -1){
         // if node has CH
         double delay = propagationDelay(DATA_M_SIZE, CH_dist);
@@ -327,15 +470,23 @@ void Sensor::sendData(){
         else
             CH = BS;
         sendDirect(DATA, delay, 0, CH->gate("in"));
+        if(phases)
+            phases->span("TDMA slot", phaseCluster(), id, simTime().dbl(), simTime().dbl() + delay, curRound);
+        if(channel){
+            // power just enough to reach the CH, the other receivers get it as interference
+            double now = simTime().dbl();
+            channel->transmit(id, x, y, Eamp * bitrate * pow(CH_dist, gamma), now, now + DATA_M_SIZE/bitrate);
+        }
         // ACCOUNT FOR DATA TRANSMISSION
         EnergyMgmt(TX, CH_dist, DATA_M_SIZE);
-
-#ifndef ONE_TX_PER_ROUND
-        // setup a timeout to receive a SCHED message for the next transmission
-        double tout = propagationDelay(SCHED_M_SIZE,CH_dist);
-        scheduleAt(simTime()+2*tout, rcvdSCHED_e);
-        //TODO FINISH TO SETUP THE TIMEOUT (ALSO FOR THE FIRST SCHED) (only needed if multiple TX per round happens)
-#endif
+        if(!Policy::oneTxPerRound) setRadio(RADIO_LISTEN); // next SCHED
+        radioBurst(RADIO_TX, DATA_M_SIZE);
+        if(!Policy::oneTxPerRound){
+            // setup a timeout to receive a SCHED message for the next transmission
+            double tout = propagationDelay(SCHED_M_SIZE,CH_dist);
+            scheduleAt(simTime()+2*tout, rcvdSCHED_e);
+            //TODO FINISH TO SETUP THE TIMEOUT (ALSO FOR THE FIRST SCHED) (only needed if multiple TX per round happens)
+        }
     }
     /*else
     {
@@ -349,46 +500,171 @@ void Sensor::sendData(){
 
 
 /**************** CLUSTER HEAD (CH) functions *********************/
+template<class Policy>
 void Sensor::broadcastADV()
 {
     double ADV_delay = propagationDelay(ADV_M_SIZE, MAX_DIST(range)); // we consider maximum distance to reach all possible nodes
 
-    for(unsigned int n = 0; n < N; n++){
-        if(n != id){
-            cModule * sensor = retrieveNode(n);
-            mAdvertisement *ADV = new mAdvertisement("CH_advertisement", ADV_M);
-            ADV->setId(id);
-            sendDirect(ADV, ADV_delay, 0,  sensor->gate("in"));
+    if(chLookup != LOOKUP_ADV)
+        chIndex->add(curRound, id, x, y);
+
+    // the index, or the batched setup at the BS, replaces the ADV events
+    if(chLookup != LOOKUP_INDEX && !batchedSetup){
+        // only the alive nodes in range hear the ADV
+        for(NeighborGraph::Iterator n = neighbors->begin(id); n != neighbors->end(id); n++){
+            if(*n != (int) id){
+                cModule * sensor = retrieveNode(*n);
+                mAdvertisement *ADV = new mAdvertisement("CH_advertisement", ADV_M);
+                ADV->setId(id);
+                sendDirect(ADV, ADV_delay, 0,  sensor->gate("in"));
+            }
         }
     }
 
-#ifdef ACCOUNT_CH_SETUP
-    // in this case, we consider an amount of energy to send a signal that
-    // covers the entire sensed area
-    EnergyMgmt(TX, MAX_DIST(range), ADV_M_SIZE);
-#endif
+    if(Policy::accountCHSetup){
+        // in this case, we consider an amount of energy to send a signal that
+        // covers the whole radio range
+        EnergyMgmt(TX, MAX_DIST(range), ADV_M_SIZE);
+    }
     // set a timeout to receive JOIN messages
     // we consider a timeout equal to the maximum distance (i.e. range*2) propagation delay for both ADV to reach sensors
     // and for the JOIN msg to reach back at CH
     double JOIN_delay = propagationDelay(JOIN_M_SIZE, MAX_DIST(range));
     scheduleAt(simTime() + ADV_delay+JOIN_delay+EPSILON, rcvdJoin_e);
+    if(phases){
+        double now = simTime().dbl();
+        phases->span("ADV", id, id, now, now + ADV_delay, curRound);
+        phases->span("JOIN", id, id, now + ADV_delay, rcvdJoin_e->getArrivalTime().dbl(), curRound);
+    }
+    radioBurst(RADIO_TX, ADV_M_SIZE); // then listening for JOINs
 
-#ifdef ACCOUNT_CH_SETUP
-    // ACCOUNT FOR ENERGY SPENT WHILE IN IDLE STATE to receive JOIN messages
-    EnergyMgmt(RX, 0, JOIN_M_SIZE);
-#endif
+    if(Policy::accountCHSetup){
+        // ACCOUNT FOR ENERGY SPENT WHILE IN IDLE STATE to receive JOIN messages
+        EnergyMgmt(RX, 0, JOIN_M_SIZE);
+    }
 
 
 }
 
+template<class Policy>
 void Sensor::advertisementPhase()
 {
     alreadyCH = true;   // node excludes itself from next election
     role = CH;
-    broadcastADV(); // broadcast ADV message
+    check_and_cast< ::BS *>(BS)->clusterHeadElected(curRound);
+    if(phases) phases->instant("election", id, id, simTime().dbl(), curRound);
+    openFrame();
+    broadcastADV<Policy>(); // broadcast ADV message
     getDisplayString().setTagArg("i", 0, "old/ball2"); // UI feedback
 }
 
+/**************** BATCHED SETUP (called by the BS, see ClusterFormation) *********************/
+void Sensor::applyClusterHead(const int *members, unsigned int n)
+{
+    Enter_Method_Silent();
+    (this->*ops->applyClusterHead)(members, n);
+}
+
+void Sensor::applyMembership(int chId, double chDist)
+{
+    Enter_Method_Silent();
+    (this->*ops->applyMembership)(chId, chDist);
+}
+
+bool Sensor::beginBatchedRound()
+{
+    Enter_Method_Silent();
+    if(role == DEAD) return false;
+    beginRound();
+    return role != DEAD;
+}
+
+double Sensor::getInitialEnergy()
+{
+    return initialEnergy;
+}
+
+void Sensor::setFrameStart(double t)
+{
+    frameStart = t;
+}
+
+void Sensor::startRoundAt(simtime_t t)
+{
+    Enter_Method_Silent(); // called by the BS when all the frames are over
+    if(role == DEAD || !startRound_e->isScheduled()) return;
+    cancelEvent(startRound_e);
+    scheduleAt(t, startRound_e);
+}
+
+void Sensor::chargeRadio()
+{
+    Enter_Method_Silent(); // called by the BS before it saves the state of the network
+    if(radioStates && role != DEAD) EnergyMgmt(RADIO, 0, 0); // the current state up to now
+}
+
+void Sensor::openFrame()
+{
+    if(!earlyRoundEnd) return;
+    frameOpen = true;
+    check_and_cast< ::BS *>(BS)->frameOpened(curRound);
+}
+
+void Sensor::closeFrame(double arrival)
+{
+    if(!frameOpen) return;
+    frameOpen = false;
+    check_and_cast< ::BS *>(BS)->frameClosed(curRound, arrival);
+}
+
+void Sensor::setRadio(radioMode m)
+{
+    if(!radioStates || role == DEAD) return;
+    radio.set(simTime().dbl(), m);
+    if(radio.getPending() > 0) EnergyMgmt(RADIO, 0, 0); // the states since the last change
+}
+
+void Sensor::radioBurst(radioMode m, unsigned int k)
+{
+    // a packet inside the current state, charged with the next change
+    if(radioStates && role != DEAD) radio.burst(m, k / bitrate);
+}
+
+template<class Policy>
+void Sensor::applyClusterHead(const int *members, unsigned int n)
+{
+    EV << "I am Cluster-Head!\n";
+    // the JOINs the members would have sent, in arrival order
+    for(unsigned int i = 0; i < n; i++){
+        mJoin *JOIN = new mJoin("join-cluster", JOIN_M);
+        JOIN->setId(members[i]);
+        msgBuf.push_back(JOIN);
+    }
+    advertisementPhase<Policy>();
+    for(unsigned int i = 0; i < n; i++)
+        radioBurst(RADIO_RX, JOIN_M_SIZE); // as each JOIN_M would be received
+}
+
+template<class Policy>
+void Sensor::applyMembership(int chId, double chDist)
+{
+    if(Policy::accountCHSetup){
+        EnergyMgmt(RX, 0, ADV_M_SIZE);
+    }
+    if(chId < 0){
+        // orphans keep the ADV timeout, so that their JOIN reaches the BS at the usual time
+        scheduleAt(simTime() + propagationDelay(ADV_M_SIZE, MAX_DIST(range))+EPSILON, rcvdADV_e);
+        return;
+    }
+    CH_id = chId;
+    CH_dist = chDist;
+    radioBurst(RADIO_TX, JOIN_M_SIZE);
+    EV << "CH designed is " << CH_id << "\n";
+    if(Policy::accountCHSetup){
+        EnergyMgmt(TX, CH_dist, JOIN_M_SIZE);
+    }
+}
+
 
 double normailized(double x,double max,double min)
 {
@@ -414,6 +690,7 @@ bool pairCompareEnergy( const std::pair<double, double> &firstEl, const std::pai
     return (firstEl.second < secondEl.second);
 }
 
+template<class Policy>
 void Sensor::createTXSched()
 {
     clusterN = msgBuf.size();
@@ -428,30 +705,27 @@ void Sensor::createTXSched()
         }
     }
 
-#ifdef CH_SLOT_MAXDIST_IN_CLUSTER
     // Ҫнڵ֮
-
-
     // ÿڵ㷢͵msgݴСͼȺе󴫲ӳ٣Ϊÿڵһʱ
-    double slot = propagationDelay(DATA_M_SIZE, sensor_max_dist);
-    double SCHED_delay = propagationDelay(SCHED_M_SIZE, sensor_max_dist);
-#else
     // TDMAмȺȵ(ȡڼȺеڵ룬ȡе󴫲ӳ)
     // Ϊ˸õرȽԴЧֱ緽ʽ
-    double slot = propagationDelay(DATA_M_SIZE, MAX_DIST(range));
-    double SCHED_delay = propagationDelay(SCHED_M_SIZE, MAX_DIST(range));
-#endif
+    double slotDist = Policy::slotMaxDistInCluster ? sensor_max_dist : MAX_DIST(range);
+    double slot = propagationDelay(DATA_M_SIZE, slotDist);
+    double SCHED_delay = propagationDelay(SCHED_M_SIZE, slotDist);
+    SCHED_delay += std::max(0.0, frameStart - simTime().dbl()); // frame offset of the cluster (see BS::colorFrames)
 
 
     // ****************************************************
     // ***************AVOID TOO CLOSE CH STRATEGY**********
     // ****************************************************
-    if(par("DistAwareCH") || par("EnergyAwareCH"))
+    if(distAwareCH || energyAwareCH)
     {
         int center_id = id;
         //ʼ
-        std::vector<std::pair<double, double>> DistBatt;
-        std::vector<std::pair<int, std::pair<double, double>>> List_IDFeat;
+        ArenaVector<std::pair<double, double>> DistBatt(RoundArena::local());
+        ArenaVector<std::pair<int, std::pair<double, double>>> List_IDFeat(RoundArena::local());
+        DistBatt.reserve(msgBuf.size() + 1); // CH plus members, no regrowth in the arena
+        List_IDFeat.reserve(msgBuf.size() + 1);
 
         double sumDist = 0;
         // ȼͷܾ
@@ -459,7 +733,7 @@ void Sensor::createTXSched()
             mJoin *JOIN = (mJoin *) msgBuf.at(y);
             sumDist += distance(JOIN->getId()); //ܾ
         }
-        double max_energy = par("energy");
+        double max_energy = initialEnergy;
         std::pair<double, double> me(sumDist,max_energy - energy);
         DistBatt.push_back(me);
         std::pair<int, std::pair<double, double>> meSupport(id,me);
@@ -471,10 +745,14 @@ void Sensor::createTXSched()
         for(unsigned int i = 0; i < msgBuf.size(); i++){
             sumDist = 0;
             mJoin *JOIN1 = (mJoin *) msgBuf.at(i);
+            bool inRange = true; // the new CH must be in range of all the members
             for(unsigned int y = 0; y < msgBuf.size(); y++){
                 mJoin *JOIN2 = (mJoin *) msgBuf.at(y);
-                sumDist += distance2s(JOIN1->getId(),JOIN2->getId());
+                double d = distance2s(JOIN1->getId(),JOIN2->getId());
+                sumDist += d;
+                if(d > range) inRange = false;
             }
+            if(!inRange) continue;
 
             Sensor *sensor = check_and_cast<Sensor *>(retrieveNode(JOIN1->getId()));
 
@@ -499,13 +777,13 @@ void Sensor::createTXSched()
             EV <<"normilized dist:" <<DistBatt[i].first <<" || costed energy:"<< DistBatt[i].second << "\n";
         }
 
-        if(par("DistAwareCH") && par("EnergyAwareCH"))
+        if(distAwareCH && energyAwareCH)
             // ;
             std::sort(DistBatt.begin(),DistBatt.end(),pairCompareBoth);
-        else if(par("DistAwareCH"))
+        else if(distAwareCH)
             //ֻݾ
             std::sort(DistBatt.begin(),DistBatt.end(),pairCompareDist);
-        else if(par("EnergyAwareCH"))
+        else if(energyAwareCH)
             //ֻ
             std::sort(DistBatt.begin(),DistBatt.end(),pairCompareEnergy);
 
@@ -529,6 +807,7 @@ void Sensor::createTXSched()
             //µĴͷ
             CH_id = center_id;
             CH_dist = distance(center_id);
+            frameOpen = false; // the new CH closes the frame
 
             // µCHʶ½ɫ
             // һϢ(ͷд)
@@ -548,7 +827,7 @@ void Sensor::createTXSched()
                 mSchedule *SCHED = (mSchedule *) new mSchedule("schedule-info", SCHED_M);
                 SCHED->setTurn(i);
                 SCHED->setDuration(slot);
-                SCHED->setRound(par("round"));
+                SCHED->setRound(curRound);
                 SCHED->setCHId(center_id); // аڼغԼ˭µĴͷ
 
                 if(JOIN->getId() != center_id){ //͸ڵ
@@ -563,10 +842,10 @@ void Sensor::createTXSched()
             }
 
             msgBuf.clear();
-            #ifdef ACCOUNT_CH_SETUP
-            //ֵôͿǽCHҪ
-            EnergyMgmt(TX, sensor_max_dist, SCHED_M_SIZE);
-            #endif
+            if(Policy::accountCHSetup){
+                //ֵôͿǽCHҪ
+                EnergyMgmt(TX, sensor_max_dist, SCHED_M_SIZE);
+            }
 
         }
         else
@@ -577,7 +856,7 @@ void Sensor::createTXSched()
                 mSchedule *SCHED = (mSchedule *) new mSchedule("schedule-info", SCHED_M);
                 SCHED->setTurn(i);
                 SCHED->setDuration(slot);
-                SCHED->setRound(par("round"));
+                SCHED->setRound(curRound);
                 SCHED->setCHId(id);
                 cModule *sensor = retrieveNode(JOIN->getId());
                 EV << "sending schedule to " << JOIN->getId() << "\n";
@@ -586,20 +865,20 @@ void Sensor::createTXSched()
             }
 
             msgBuf.clear();
-            #ifdef ACCOUNT_CH_SETUP
-            //ֵôͿǽCHҪ
-            EnergyMgmt(TX, sensor_max_dist, SCHED_M_SIZE);
-            #endif
+            if(Policy::accountCHSetup){
+                //ֵôͿǽCHҪ
+                EnergyMgmt(TX, sensor_max_dist, SCHED_M_SIZE);
+            }
 
 
             double IDLE_duration = clusterN*slot;
             //һʱʹߵ紦ڿģʽ(TDMA)
             // ʱSCHED msgĿĵز˳еݡ
             scheduleAt(simTime() + SCHED_delay + IDLE_duration + EPSILON, rcvdData_e);
-            #ifdef ACCOUNT_CH_SETUP
-            //ֵôͿǽCHҪ
-            EnergyMgmt(RX, 0, clusterN*DATA_M_SIZE);
-            #endif
+            if(Policy::accountCHSetup){
+                //ֵôͿǽCHҪ
+                EnergyMgmt(RX, 0, clusterN*DATA_M_SIZE);
+            }
         }
 
     }
@@ -614,7 +893,7 @@ void Sensor::createTXSched()
             mSchedule *SCHED = (mSchedule *) new mSchedule("schedule-info", SCHED_M);
             SCHED->setTurn(i);
             SCHED->setDuration(slot);
-            SCHED->setRound(par("round"));
+            SCHED->setRound(curRound);
             SCHED->setCHId(id);
             cModule *sensor = retrieveNode(JOIN->getId());
             EV << "sending schedule to " << JOIN->getId() << "\n";
@@ -623,24 +902,40 @@ void Sensor::createTXSched()
         }
 
         msgBuf.clear();
-        #ifdef ACCOUNT_CH_SETUP
-        //ֵôͿǽCHҪ
-        EnergyMgmt(TX, sensor_max_dist, SCHED_M_SIZE);
-        #endif
+        if(Policy::accountCHSetup){
+            //ֵôͿǽCHҪ
+            EnergyMgmt(TX, sensor_max_dist, SCHED_M_SIZE);
+        }
 
 
         double IDLE_duration = clusterN*slot;
         scheduleAt(simTime() + SCHED_delay + IDLE_duration + EPSILON, rcvdData_e);
-        #ifdef ACCOUNT_CH_SETUP
-        EnergyMgmt(RX, 0, clusterN*DATA_M_SIZE);
-        #endif
+        if(Policy::accountCHSetup){
+            EnergyMgmt(RX, 0, clusterN*DATA_M_SIZE);
+        }
+    }
+
+    // asleep from the SCHED to the frame of the cluster
+    setRadio(RADIO_SLEEP);
+    radioBurst(RADIO_TX, SCHED_M_SIZE);
+    if(radioStates && rcvdData_e->isScheduled())
+        radio.plan(simTime().dbl() + SCHED_delay, RADIO_LISTEN);
+
+    if(phases){
+        // the gap between SCHED and the frame is the frame offset of the cluster
+        double now = simTime().dbl();
+        phases->span("SCHED", id, id, now, now + propagationDelay(SCHED_M_SIZE, slotDist), curRound);
+        if(rcvdData_e->isScheduled()) // not if the frame was handed over
+            phases->span("TDMA frame", id, id, now + SCHED_delay, rcvdData_e->getArrivalTime().dbl(), curRound);
     }
 }
 
+template<class Policy>
 void Sensor::compressAndSendToBS()
 {
     //compress all data received
     EnergyMgmt(COMPRESS, 0, clusterN*DATA_M_SIZE);
+    setRadio(Policy::oneTxPerRound ? RADIO_SLEEP : RADIO_LISTEN); // after the upload: until the next round, or the next JOIN check
 
     //send to base station
     //compute energy to send data considering maximum distance (i.e. highest energy)
@@ -648,47 +943,111 @@ void Sensor::compressAndSendToBS()
     //unsigned int data_aggr_size = ceil((clusterN*DATA_M_SIZE)/COMP_FACTOR);
     unsigned int data_aggr_size = DATA_M_SIZE; // we just assume all the same packet size transmitted to BS after compression
 
-#ifdef USE_BS_DIST
-    EnergyMgmt(TX, BS_DIST(x,y), data_aggr_size);
-#else
-    EnergyMgmt(TX, MAX_DIST(range), data_aggr_size);
-#endif
-
-#ifndef ONE_TX_PER_ROUND
-    // set-up the next transmission
-    // in this case, we avoid to clear the buffer. We're gonna exploit polymorphism to
-    // use DATA packets as JOIN packets in the new schedule creation (they both have id field).
-    // This is useful for keeping track of nodes that are still sending DATA (in case someone died) and adjust
-    // the TDMA schedule accordingly
-#ifdef USE_BS_DIST
-    double delay = propagationDelay(data_aggr_size, BS_DIST(x,y));
-#else
-    double delay = propagationDelay(data_aggr_size, MAX_DIST(range));
-#endif
-    scheduleAt(simTime()+delay,rcvdJoin_e); // schedule next transmission after Aggregated data has been (virtually) sent
-#endif
+    // timestamps of the readings aggregated, for the latency at the BS
+    mAggregate *AGGR = new mAggregate("aggregate", AGGREGATE_M);
+    AGGR->setId(id);
+    AGGR->setRound(curRound);
+    ArenaVector<const float *> payloads(RoundArena::local());
+    payloads.reserve(msgBuf.size());
+    for(unsigned int i = 0; i < msgBuf.size(); i++){
+        if(msgBuf[i]->getKind() != DATA_M) continue;
+        mData *DATA = (mData *) msgBuf[i];
+        simtime_t created = DATA->getCreated();
+        if(AGGR->getCount() == 0 || created < AGGR->getOldest()) AGGR->setOldest(created);
+        if(AGGR->getCount() == 0 || created > AGGR->getNewest()) AGGR->setNewest(created);
+        AGGR->setCount(AGGR->getCount() + 1);
+        if(DATA->getSamples().size() == samplesPerReading)
+            payloads.push_back(DATA->getSamples().data());
+    }
+    if(aggregator){
+        // real payloads: the encoded aggregate is what goes to the BS
+        unsigned int bytes = aggregator->aggregate(payloads.data(), payloads.size(), samplesPerReading);
+        data_aggr_size = AGGR_HEADER_SIZE + 8*bytes;
+        AGGR->setPayload(aggregator->getPayload());
+    }
+
+    double delay;
+    if(routes)
+        delay = forwardToBS(data_aggr_size); // first hop of the min-energy path
+    else{
+        EnergyMgmt(TX, bsDist<Policy>(), data_aggr_size);
+        radioBurst(RADIO_TX, data_aggr_size);
+        delay = propagationDelay(data_aggr_size, bsDist<Policy>());
+    }
+    if(phases){
+        double now = simTime().dbl();
+        phases->instant("aggregation", id, id, now, curRound);
+        phases->span("BS upload", id, id, now, now + (delay >= 0 ? delay : propagationDelay(data_aggr_size, bsDist<Policy>())), curRound);
+    }
+    if(AGGR->getCount() > 0 && delay >= 0)
+        sendDirect(AGGR, delay, 0, BS->gate("in"));
+    else
+        delete AGGR; // nothing to report, or lost on the way
+    closeFrame(simTime().dbl() + (delay >= 0 ? delay : 0)); // aggregate at the BS (over the relays), or lost now
+
+    if(!Policy::oneTxPerRound){
+        // set-up the next transmission
+        // in this case, we avoid to clear the buffer. We're gonna exploit polymorphism to
+        // use DATA packets as JOIN packets in the new schedule creation (they both have id field).
+        // This is useful for keeping track of nodes that are still sending DATA (in case someone died) and adjust
+        // the TDMA schedule accordingly
+        double delay = propagationDelay(data_aggr_size, bsDist<Policy>());
+        scheduleAt(simTime()+delay,rcvdJoin_e); // schedule next transmission after Aggregated data has been (virtually) sent
+    }
 }
 
 void Sensor::handleData(cMessage *msg)
 {
-    int r = par("round");
+    int r = curRound;
     mData *DATA = (mData *) msg;
     if ((role == CH) && (r == DATA->getRound())){
+        radioBurst(RADIO_RX, DATA_M_SIZE); // received even if lost to interference
+        double sinr;
+        if(channel && !channel->receive(DATA->getId(), x, y, sinr)){
+            EV << "data from " << DATA->getId() << " lost, SINR " << 10*log10(sinr) << " dB\n";
+            delete msg;
+            return;
+        }
         msgBuf.push_back(msg); // insert DATA into the message buffer
         EV << "received data from " << msg->getSenderModuleId() - 2 << "\n";
     }
 }
 
+// delay from here to the BS, -1 if lost on the way
+double Sensor::forwardToBS(unsigned int k)
+{
+    int next = routes->getNextHop(id);
+    double hop = propagationDelay(k, routes->getHopDist(id));
+    EnergyMgmt(TX, routes->getHopDist(id), k);
+    radioBurst(RADIO_TX, k);
+    if(role == DEAD) return -1; // lost with us
+    if(next < 0) return hop; // delivered to the BS
+    double rest = (*nodes)[next]->relay(k);
+    return rest < 0 ? -1 : hop + rest;
+}
+
+double Sensor::relay(unsigned int k)
+{
+    Enter_Method_Silent(); // called by the previous hop
+    if(role == DEAD) return -1;
+    radioBurst(RADIO_RX, k);
+    EnergyMgmt(RX, 0, k);
+    if(role == DEAD) return -1;
+    return forwardToBS(k);
+}
+
 /********* ENERGY functions **********/
 // energy consumption to transmit k bit ad distance d
 double Sensor::EnergyTX(unsigned int k, double d)
 {
+    if(radioStates) return Eamp * k * pow(d,2); // the electronics are in the TX state
     return ((Eelec * k) + Eamp * k * pow(d,2));
 }
 
 // energy consumption to receive k bit
 double Sensor::EnergyRX(unsigned int k)
 {
+    if(radioStates) return 0; // in the RX state
     return Eelec * k;
 }
 
@@ -718,6 +1077,10 @@ void Sensor::EnergyMgmt(compState state, double d, unsigned int k)
             cost = EnergyCompress(k);
             EV << "Compression cost is " << cost << " and energy is " << energy << " " << (cost < energy) << "\n";
             break;
+        case RADIO:
+            cost = radio.take(simTime().dbl());
+            EV << "Radio cost is " << cost << " and energy is " << energy << " " << (cost < energy) << "\n";
+            break;
     }
 
     emit(energySignal, energy);
@@ -726,6 +1089,7 @@ void Sensor::EnergyMgmt(compState state, double d, unsigned int k)
     {
         // if we have enough energy, subtract the cost of operation from the actual energy
         energy -= cost;
+        lifetime->energySpent(cost, curRound);
         char buf[256];
         sprintf(buf, "energy %.2f\n", energy);
         getDisplayString().setTagArg("t", 0, buf);
@@ -734,15 +1098,20 @@ void Sensor::EnergyMgmt(compState state, double d, unsigned int k)
     {
         //this operation will make the node die, so we can simply declare it as dead
         role = DEAD;
+        deathRound = curRound;
+        lifetime->nodeDied(energy, deathRound);
+        neighbors->remove(id);
+        if(routes) routes->remove(id); // route the nodes that relayed through us again
+        closeFrame(simTime().dbl());
         EV << "Node " << id << " is DEAD.\n";
         getDisplayString().setTagArg("i", 0, "old/ball"); // UI feedback
         getDisplayString().setTagArg("i2", 0, "old/x_cross");
         cancelEvent(startRound_e);
         unsigned int Ndead = getParentModule()->par("Ndead");
         getParentModule()->par("Ndead") = Ndead+1;
-        if (Ndead+1 == N) endSimulation(); // stop simulation if all nodes are dead
+        if (Ndead+1 == N) check_and_cast< ::BS *>(BS)->networkDead(); // stop simulation (or repetition) if all nodes are dead
         int r = getParentModule()->par("round");
-        if (Ndead+1 == 1) recordScalar("firstNodeDead", r);
+        if (Ndead+1 == 1 && lifetime->getRuns() == 0) recordScalar("firstNodeDead", r); // first warm repetition only
     }
 }
 
@@ -750,9 +1119,7 @@ void Sensor::EnergyMgmt(compState state, double d, unsigned int k)
 /********* Utilities ************/
 cModule* Sensor::retrieveNode(unsigned int n)
 {
-   char modName[32];
-   sprintf(modName,"node[%d]", n);
-   return (cModule *) getModuleByPath(modName);
+   return (*nodes)[n];
 }
 
 double Sensor::propagationDelay(unsigned int msg_size, double dist)
@@ -765,9 +1132,9 @@ double Sensor::propagationDelay(unsigned int msg_size, double dist)
 
 double Sensor::distance(unsigned int id)
 {
-    cModule *sensor = retrieveNode(id);
-    int sx = sensor->par("posX");
-    int sy = sensor->par("posY");
+    const Sensor *sensor = (*nodes)[id];
+    int sx = sensor->x;
+    int sy = sensor->y;
     double dx = x - ((double) sx);
     double dy = y - ((double) sy);
     return sqrt( pow(dx,2) + pow(dy,2));
@@ -775,12 +1142,12 @@ double Sensor::distance(unsigned int id)
 
 double Sensor::distance2s(unsigned int id1, unsigned int id2)
 {
-    cModule *sensor1 = retrieveNode(id1);
-    int sx1 = sensor1->par("posX");
-    int sy1 = sensor1->par("posY");
-    cModule *sensor2 = retrieveNode(id2);
-    int sx2 = sensor2->par("posX");
-    int sy2 = sensor2->par("posY");
+    const Sensor *sensor1 = (*nodes)[id1];
+    int sx1 = sensor1->x;
+    int sy1 = sensor1->y;
+    const Sensor *sensor2 = (*nodes)[id2];
+    int sx2 = sensor2->x;
+    int sy2 = sensor2->y;
     double dx = ((double) sx1) - ((double) sx2);
     double dy = ((double) sy1) - ((double) sy2);
     return sqrt( pow(dx,2) + pow(dy,2));
@@ -791,3 +1158,37 @@ double Sensor::getEnergy()
     return energy;
 }
 
+NodeState Sensor::getState()
+{
+    NodeState s;
+    s.energy = energy;
+    s.initialEnergy = initialEnergy;
+    s.x = x;
+    s.y = y;
+    s.alreadyCH = alreadyCH;
+    s.role = role;
+    s.deathRound = deathRound;
+    return s;
+}
+
+void Sensor::restoreState(const NodeState &s)
+{
+    energy = s.energy;
+    initialEnergy = s.initialEnergy; // not drawn again: the streams of the warm-up also drew the positions
+    x = s.x;
+    y = s.y;
+    par("posX") = x;
+    par("posY") = y;
+    alreadyCH = s.alreadyCH;
+    role = (nodeRole) s.role;
+    deathRound = s.deathRound;
+    if(role == DEAD)
+        getDisplayString().setTagArg("i2", 0, "old/x_cross"); // UI feedback
+}
+
+template<class Policy>
+const Sensor::Ops *Sensor::Ops::get()
+{
+    static const Ops ops = { &Sensor::handleMessage<Policy>, &Sensor::applyClusterHead<Policy>, &Sensor::applyMembership<Policy> };
+    return &ops;
+}
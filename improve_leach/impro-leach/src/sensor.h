@@ -17,8 +17,21 @@
 #define __IMPRO_LEACH_SENSOR_H_
 #include <limits>
 #include <algorithm>
+#include <cstring>
 #include <omnetpp.h>
 #include "common.h"
+#include "snapshot.h"
+#include "lifetime.h"
+#include "chindex.h"
+#include "election.h"
+#include "arena.h"
+#include "neighbors.h"
+#include "routing.h"
+#include "sinr.h"
+#include "aggregation.h"
+#include "trace.h"
+#include "phasetrace.h"
+#include "radio.h"
 
 using namespace omnetpp;
 
@@ -29,8 +42,10 @@ class Sensor : public cSimpleModule
     unsigned int id;        // sensor id
     unsigned int N;         // nodes in the network
     int x,y;                // coordinates of sensor (m)
+    int curRound = -1;      // same as par("round"), without the parameter lookup
     bool alreadyCH = false; // indicates whether the node has elected himself a CH or not in the current round
     double P;               // proportion of CH in the current network
+    bool adaptiveP;         // P is updated by the BS every round
 
     int CH_id = -1;         // Cluster-Head id
     double CH_dist;         // Cluster-Head distance
@@ -40,16 +55,49 @@ class Sensor : public cSimpleModule
     double sensor_max_dist; // used by CH to adjust power of transmission
     unsigned int clusterN;  // used by CH to keep track of the num. of nodes in the cluster
     nodeRole role = SENSOR;
-    double roundTime;
+    double roundTime = 0;
+    double frameStart = 0;  // start of the TDMA frame of our cluster, set by the BS (0: as soon as the JOINs are in)
+    bool earlyRoundEnd;     // the BS starts the next round when the last aggregate is in (adaptiveFrames)
+    bool frameOpen = false; // we are the CH of a frame the BS is waiting for
 
     cModule *BS;
+    LifetimeStats *lifetime; // network lifetime statistics kept by the BS
+    ClusterHeadIndex *chIndex; // positions of the CHs of the current round, kept by the BS
+    chLookupMode chLookup;  // how the nearest CH is found
+    ElectionStrategy *election; // threshold used in the CH election
+    bool batchedSetup;      // setup phase computed by the BS for all the nodes
+    bool distAwareCH, energyAwareCH; // par("DistAwareCH"), par("EnergyAwareCH")
+    const std::vector<Sensor *> *nodes; // all the nodes, kept by the BS
+    NeighborGraph *neighbors; // alive nodes in radio range, kept by the BS
+    RoutingTree *routes;    // min-energy paths to the BS, kept by the BS (nullptr for direct transmission)
+    InterferenceChannel *channel; // SINR reception of DATA, kept by the BS (nullptr if interference is ignored)
+    unsigned int samplesPerReading; // payload of each DATA
+    ClusterAggregator *aggregator; // CH operators on the payloads, kept by the BS (nullptr without payload)
+    TraceSource *trace;     // readings, kept by the BS (nullptr without payload)
+    PhaseTrace *phases;     // round phases, kept by the BS (nullptr if not recorded)
+
+    // protocol variant, chosen once in initialize() (see LeachPolicy)
+    struct Ops
+    {
+        typedef const Ops *type;
+        void (Sensor::*handleMessage)(cMessage *msg);
+        void (Sensor::*applyClusterHead)(const int *members, unsigned int n);
+        void (Sensor::*applyMembership)(int chId, double chDist);
+        template<class Policy> static const Ops *get();
+    };
+    const Ops *ops;
 
     double C = LIGHTSPEED;
     double bitrate;   // bitrate of sensors
-    double range;        // it will be the max communication range of sensors
+    double range;        // radio range of sensors
+    double diagonal;     // diagonal of the field, used as distance to the BS when it is not computed
 
     double Eelec, Eamp, Ecomp, gamma;  // energy parameters
+    bool radioStates;           // electronics from the time in each radio state instead of Eelec per bit
+    RadioState radio;
     double energy;              // initial battery energy
+    double initialEnergy;
+    int deathRound = -1;        // round in which the node died
 
     std::vector<cMessage *> msgBuf;
 
@@ -62,10 +110,6 @@ class Sensor : public cSimpleModule
 
     // TODO when the CH dies, setup a timeout to  get the next SCHED event. If not received, start transmitting to the base.
     // (not needed if we perform only one transmission per round)
-    // TODO when sending message considering a certain range, we should not allow message to reach
-    // destination when are further from maximum distance
-    // by grouping everything in a function we can also compute the delay based on distance
-    // (now we don't need it since area is designed to let all sensors talk to each other)
 
     simsignal_t energySignal;
 
@@ -73,31 +117,55 @@ class Sensor : public cSimpleModule
     virtual void initialize();
     virtual void finish();
     virtual void reset();
+    virtual void deploy();
     virtual void handleMessage(cMessage *msg);
+    template<class Policy> void handleMessage(cMessage *msg);
 
     virtual cModule* retrieveNode(unsigned int n);
     virtual double propagationDelay(unsigned int msg_size, double dist);
     virtual double distance(unsigned int id);
     virtual double distance2s(unsigned int id1, unsigned int id2);
     virtual double T(unsigned int n);
-    virtual void advertisementPhase();
-    virtual void selfElection();
-    virtual void broadcastADV();
-    virtual void chooseCH();
-    virtual void createTXSched();
+    virtual void beginRound();
     virtual void setupDataTX(mSchedule *SCHED);
-    virtual void sendData();
-    virtual void initOrphan();
-    virtual void compressAndSendToBS();
     virtual void handleData(cMessage *msg);
     virtual double EnergyTX(unsigned int k, double d);
     virtual double EnergyRX(unsigned int k);
     virtual double EnergyCompress(unsigned int kN);
     virtual void EnergyMgmt(compState state, double d, unsigned int k);
-
+    virtual void setRadio(radioMode m);
+    virtual void radioBurst(radioMode m, unsigned int k);
+    virtual double forwardToBS(unsigned int k);
+    virtual void openFrame();
+    virtual void closeFrame(double arrival);
+    int phaseCluster() const { return CH_id == BS_ID ? -1 : CH_id; } // track of our cluster in the phase trace
+
+    // code that depends on the protocol variant
+    template<class Policy> void advertisementPhase();
+    template<class Policy> void selfElection();
+    template<class Policy> void broadcastADV();
+    template<class Policy> void chooseCH();
+    template<class Policy> void createTXSched();
+    template<class Policy> void sendData();
+    template<class Policy> void initOrphan();
+    template<class Policy> void compressAndSendToBS();
+    template<class Policy> void applyClusterHead(const int *members, unsigned int n);
+    template<class Policy> void applyMembership(int chId, double chDist);
+    template<class Policy> double bsDist() const { return Policy::useBSDist ? BS_DIST(x,y) : MAX_DIST(diagonal); }
 
   public:
     virtual double getEnergy();
+    virtual NodeState getState();
+    virtual void restoreState(const NodeState &s);
+    virtual void fullReset();
+    virtual bool beginBatchedRound();
+    virtual double getInitialEnergy();
+    virtual void applyClusterHead(const int *members, unsigned int n);
+    virtual void applyMembership(int chId, double chDist);
+    virtual double relay(unsigned int k);
+    virtual void setFrameStart(double t);
+    virtual void startRoundAt(simtime_t t);
+    virtual void chargeRadio();
 };
 
 
@@ -0,0 +1,189 @@
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with this program.  If not, see http://www.gnu.org/licenses/.
+//
+
+#include <algorithm>
+#include <cmath>
+#include "sinr.h"
+
+#define SINR_LEAF_SIZE 8        // transmitters summed exactly in a leaf
+#define SINR_MAX_DEPTH 32       // for transmitters in the same position
+#define SINR_NEAR_FIELD2 1.0    // squared distance (m^2) below which the path loss is not applied
+
+static inline double pathGain(double d2, double gamma)
+{
+    d2 = std::max(d2, SINR_NEAR_FIELD2);
+    return gamma == 2 ? 1 / d2 : pow(d2, -gamma/2);
+}
+
+void InterferenceTree::add(double x, double y, double power)
+{
+    Point p;
+    p.x = x;
+    p.y = y;
+    p.power = power;
+    points.push_back(p);
+}
+
+void InterferenceTree::build()
+{
+    cells.clear();
+    if(points.empty()) return;
+    double minX = points[0].x, maxX = minX, minY = points[0].y, maxY = minY;
+    for(unsigned int i = 1; i < points.size(); i++){
+        minX = std::min(minX, points[i].x); maxX = std::max(maxX, points[i].x);
+        minY = std::min(minY, points[i].y); maxY = std::max(maxY, points[i].y);
+    }
+    build(0, points.size(), minX, minY, std::max(maxX - minX, maxY - minY), 0);
+}
+
+int InterferenceTree::build(int begin, int end, double x0, double y0, double size, int depth)
+{
+    int c = cells.size();
+    cells.push_back(Cell());
+    Cell cell;
+    cell.power = cell.cx = cell.cy = 0;
+    for(int i = begin; i < end; i++){
+        cell.power += points[i].power;
+        cell.cx += points[i].power * points[i].x;
+        cell.cy += points[i].power * points[i].y;
+    }
+    if(cell.power > 0){
+        cell.cx /= cell.power;
+        cell.cy /= cell.power;
+    }
+    cell.size = size;
+    cell.begin = begin;
+    cell.end = end;
+    for(int q = 0; q < 4; q++)
+        cell.child[q] = -1;
+
+    if(end - begin > SINR_LEAF_SIZE && depth < SINR_MAX_DEPTH){
+        // quadrants: split on x, then each half on y
+        double h = size / 2, mx = x0 + h, my = y0 + h;
+        Point *p = points.data();
+        int midX = std::partition(p + begin, p + end, [mx](const Point &a) { return a.x < mx; }) - p;
+        int midL = std::partition(p + begin, p + midX, [my](const Point &a) { return a.y < my; }) - p;
+        int midR = std::partition(p + midX, p + end, [my](const Point &a) { return a.y < my; }) - p;
+        int bounds[5] = { begin, midL, midX, midR, end };
+        double ox[4] = { x0, x0, mx, mx }, oy[4] = { y0, my, y0, my };
+        for(int q = 0; q < 4; q++)
+            if(bounds[q+1] > bounds[q])
+                cell.child[q] = build(bounds[q], bounds[q+1], ox[q], oy[q], h, depth+1);
+    }
+    cells[c] = cell;
+    return c;
+}
+
+double InterferenceTree::field(double x, double y, double gamma, double theta)
+{
+    double sum = 0;
+    if(cells.empty()) return sum;
+    stack.clear();
+    stack.push_back(0);
+    while(!stack.empty()){
+        const Cell &c = cells[stack.back()];
+        stack.pop_back();
+        bool leaf = c.child[0] < 0 && c.child[1] < 0 && c.child[2] < 0 && c.child[3] < 0;
+        if(leaf){
+            for(int i = c.begin; i < c.end; i++){
+                double dx = x - points[i].x, dy = y - points[i].y;
+                sum += points[i].power * pathGain(dx*dx + dy*dy, gamma);
+            }
+            continue;
+        }
+        double dx = x - c.cx, dy = y - c.cy;
+        double d2 = dx*dx + dy*dy;
+        if(c.size*c.size < theta*theta*d2)
+            sum += c.power * pathGain(d2, gamma); // far enough: one transmitter
+        else
+            for(int q = 0; q < 4; q++)
+                if(c.child[q] >= 0) stack.push_back(c.child[q]);
+    }
+    return sum;
+}
+
+void InterferenceChannel::setModel(double g, double noiseDBW, double thresholdDB, double t)
+{
+    gamma = g;
+    noise = pow(10, noiseDBW / 10);
+    threshold = pow(10, thresholdDB / 10);
+    theta = t;
+}
+
+void InterferenceChannel::setNodeChannel(int node, int channel)
+{
+    if((unsigned int) node >= nodeChannel.size()) nodeChannel.resize(node + 1, 0);
+    nodeChannel[node] = channel;
+}
+
+void InterferenceChannel::transmit(int sender, double x, double y, double power, double start, double end)
+{
+    Transmission t;
+    t.x = x;
+    t.y = y;
+    t.power = power;
+    t.start = start;
+    t.end = end;
+    t.channel = (unsigned int) sender < nodeChannel.size() ? nodeChannel[sender] : 0;
+    if((unsigned int) sender >= last.size()) last.resize(sender + 1);
+    last[sender] = t;
+
+    // transmissions that cannot overlap any reception from now on
+    maxDuration = std::max(maxDuration, end - start);
+    unsigned int k = 0;
+    while(k < active.size() && active[k].end + 2*maxDuration < start)
+        k++;
+    if(k > 0) active.erase(active.begin(), active.begin() + k);
+    active.push_back(t);
+
+    if(treeValid && t.channel == treeChannel && start < treeEnd && end > treeStart)
+        treeValid = false;
+}
+
+bool InterferenceChannel::receive(int sender, double x, double y, double &sinr)
+{
+    const Transmission &t = last[sender];
+    if(!treeValid || t.start != treeStart || t.end != treeEnd || t.channel != treeChannel){
+        // transmissions concurrent with this one (the same for the whole slot)
+        tree.clear();
+        for(unsigned int i = 0; i < active.size(); i++)
+            if(active[i].channel == t.channel && active[i].start < t.end && active[i].end > t.start)
+                tree.add(active[i].x, active[i].y, active[i].power);
+        tree.build();
+        treeValid = true;
+        treeStart = t.start;
+        treeEnd = t.end;
+        treeChannel = t.channel;
+    }
+
+    double dx = x - t.x, dy = y - t.y;
+    double signal = t.power * pathGain(dx*dx + dy*dy, gamma);
+    double interference = std::max(0.0, tree.field(x, y, gamma, theta) - signal);
+    sinr = signal / (noise + interference);
+    bool ok = sinr >= threshold;
+    if(ok) received++;
+    else lost++;
+    return ok;
+}
+
+void InterferenceChannel::reset()
+{
+    active.clear();
+    last.clear();
+    nodeChannel.clear();
+    tree.clear();
+    treeValid = false;
+    maxDuration = 0;
+}
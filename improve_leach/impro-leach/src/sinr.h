@@ -0,0 +1,100 @@
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with this program.  If not, see http://www.gnu.org/licenses/.
+//
+
+#ifndef __IMPRO_LEACH_SINR_H_
+#define __IMPRO_LEACH_SINR_H_
+
+#include <vector>
+
+/**
+ * Sum of the powers received at a point from a set of transmitters, power*d^-gamma,
+ * with the Barnes-Hut approximation: a quadtree cell of size s seen from a
+ * distance d > s/theta counts as a single transmitter with its total power
+ * in its power-weighted center. theta = 0 gives the exact sum.
+ */
+class InterferenceTree
+{
+  private:
+    struct Point
+    {
+        double x, y, power;
+    };
+    struct Cell
+    {
+        double cx, cy, power;   // power-weighted center, total power
+        double size;            // edge of the cell
+        int child[4];           // -1 if missing
+        int begin, end;         // points of a leaf
+    };
+    std::vector<Point> points;
+    std::vector<Cell> cells;
+    std::vector<int> stack;
+
+    int build(int begin, int end, double x0, double y0, double size, int depth);
+
+  public:
+    void clear() { points.clear(); cells.clear(); }
+    void add(double x, double y, double power);
+    void build();
+    double field(double x, double y, double gamma, double theta);
+    unsigned int size() const { return points.size(); }
+};
+
+/**
+ * SINR reception of DATA messages: every transmission on the same channel
+ * overlapping the one being received interferes with it.
+ *
+ * Senders register their transmission (position, power, time interval);
+ * receivers ask whether the last transmission of a sender was received.
+ * All the receivers of a TDMA slot query the same time interval, so the
+ * interference tree is built once per slot (O(T log T) for T concurrent
+ * transmissions) and each query costs O(log T).
+ */
+class InterferenceChannel
+{
+  private:
+    struct Transmission
+    {
+        double x, y, power, start, end;
+        int channel;
+    };
+    double gamma = 2;
+    double noise = 0;           // W
+    double threshold = 1;       // minimum SINR (linear)
+    double theta = 0.5;
+    std::vector<Transmission> active; // in start order
+    std::vector<Transmission> last;   // last transmission of each sender
+    std::vector<int> nodeChannel;     // frequency channel of each sender
+    double maxDuration = 0;
+
+    InterferenceTree tree;
+    bool treeValid = false;
+    double treeStart = 0, treeEnd = 0;
+    int treeChannel = 0;
+
+    unsigned long received = 0, lost = 0;
+
+  public:
+    void setModel(double gamma, double noiseDBW, double thresholdDB, double theta);
+    void setNodeChannel(int node, int channel);
+    void transmit(int sender, double x, double y, double power, double start, double end);
+    bool receive(int sender, double x, double y, double &sinr);
+    void reset();
+
+    unsigned long getReceived() const { return received; }
+    unsigned long getLost() const { return lost; }
+};
+
+#endif
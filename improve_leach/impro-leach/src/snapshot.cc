@@ -0,0 +1,99 @@
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with this program.  If not, see http://www.gnu.org/licenses/.
+//
+
+#include <cstdio>
+#include <cstring>
+#include <map>
+#include "snapshot.h"
+
+using namespace omnetpp;
+
+#define SNAPSHOT_MAGIC "LEACHSNP"
+#define SNAPSHOT_VERSION 2
+
+struct SnapshotHeader
+{
+    char magic[8];
+    unsigned int version;
+    unsigned int N;
+    int round;
+    unsigned int Ndead;
+    double time;
+};
+
+int NetSnapshot::firstNodeDead() const
+{
+    int fnd = -1;
+    for(unsigned int n = 0; n < nodes.size(); n++){
+        int d = nodes[n].deathRound;
+        if((d >= 0) && ((fnd < 0) || (d < fnd)))
+            fnd = d;
+    }
+    return fnd;
+}
+
+void NetSnapshot::save(const char *fileName) const
+{
+    FILE *f = fopen(fileName, "wb");
+    if(!f)
+        throw cRuntimeError("Cannot open snapshot file '%s' for writing", fileName);
+
+    SnapshotHeader h;
+    memcpy(h.magic, SNAPSHOT_MAGIC, sizeof(h.magic));
+    h.version = SNAPSHOT_VERSION;
+    h.N = nodes.size();
+    h.round = round;
+    h.Ndead = Ndead;
+    h.time = time;
+
+    bool ok = fwrite(&h, sizeof(h), 1, f) == 1;
+    if(ok && h.N > 0)
+        ok = fwrite(nodes.data(), sizeof(NodeState), h.N, f) == h.N;
+    fclose(f);
+    if(!ok)
+        throw cRuntimeError("Cannot write snapshot file '%s'", fileName);
+}
+
+std::shared_ptr<const NetSnapshot> NetSnapshot::load(const char *fileName)
+{
+    // snapshots never change once written: keep them for the other branches run by this process
+    static std::map<std::string, std::shared_ptr<const NetSnapshot>> cache;
+    auto it = cache.find(fileName);
+    if(it != cache.end())
+        return it->second;
+
+    FILE *f = fopen(fileName, "rb");
+    if(!f)
+        throw cRuntimeError("Cannot open snapshot file '%s' (run the warm-up configuration first)", fileName);
+
+    SnapshotHeader h;
+    if((fread(&h, sizeof(h), 1, f) != 1) || memcmp(h.magic, SNAPSHOT_MAGIC, sizeof(h.magic)) || (h.version != SNAPSHOT_VERSION)){
+        fclose(f);
+        throw cRuntimeError("'%s' is not a valid snapshot file", fileName);
+    }
+
+    auto snap = std::make_shared<NetSnapshot>();
+    snap->round = h.round;
+    snap->time = h.time;
+    snap->Ndead = h.Ndead;
+    snap->nodes.resize(h.N);
+    bool ok = (h.N == 0) || (fread(snap->nodes.data(), sizeof(NodeState), h.N, f) == h.N);
+    fclose(f);
+    if(!ok)
+        throw cRuntimeError("Snapshot file '%s' is truncated", fileName);
+
+    cache[fileName] = snap;
+    return snap;
+}
@@ -0,0 +1,59 @@
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with this program.  If not, see http://www.gnu.org/licenses/.
+//
+
+#ifndef __IMPRO_LEACH_SNAPSHOT_H_
+#define __IMPRO_LEACH_SNAPSHOT_H_
+
+#include <memory>
+#include <string>
+#include <vector>
+#include "common.h"
+
+/**
+ * Per-node state needed to resume a LEACH run at the start of a round.
+ */
+struct NodeState
+{
+    double energy;      // residual battery energy (J)
+    double initialEnergy; // battery drawn by the warm-up run (J)
+    int x, y;           // coordinates of sensor (m)
+    int alreadyCH;      // the node has already been CH in the current epoch
+    int role;           // nodeRole
+    int deathRound;     // round in which the node died (-1 if alive)
+};
+
+/**
+ * State of the whole network at the start of a round.
+ *
+ * A warm-up run saves it once (forkRound/forkFile in Base_net), then every
+ * branch configuration resumes from it instead of re-simulating the prefix.
+ * Loaded snapshots are immutable and cached per file, so branches executed
+ * in the same process share a single copy and each node only copies its own
+ * record.
+ */
+class NetSnapshot
+{
+  public:
+    int round = 0;              // first round to be simulated after resume
+    double time = 0;            // simulation time at which that round starts
+    unsigned int Ndead = 0;     // dead nodes at snapshot time
+    std::vector<NodeState> nodes;
+
+    int firstNodeDead() const;  // round of the first death, -1 if none
+    void save(const char *fileName) const;
+    static std::shared_ptr<const NetSnapshot> load(const char *fileName);
+};
+
+#endif
@@ -0,0 +1,184 @@
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with this program.  If not, see http://www.gnu.org/licenses/.
+//
+
+#include <cmath>
+#include <cstring>
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+#include "trace.h"
+#include "common.h"
+
+using namespace omnetpp;
+
+#define TRACE_MAGIC "LEACHTRC"
+#define TRACE_VERSION 1
+
+#define TRACE_COMPONENTS 4      // plane waves of the synthetic field
+#define TRACE_SAMPLE_PERIOD 0.01 // s between the samples of a reading
+#define TRACE_ROUND_PERIOD 1.0  // s between the readings of two rounds
+#define TRACE_NOISE 0.05        // amplitude of the white noise of the synthetic field
+
+struct TraceHeader
+{
+    char magic[8];
+    uint32_t version;
+    uint32_t nodes;
+    uint32_t rounds;
+    uint32_t samples;
+};
+
+FileTrace::FileTrace(const char *fileName, unsigned int minNodes, unsigned int minSamples)
+{
+    const void *base = nullptr;
+#ifdef _WIN32
+    file = CreateFileA(fileName, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+    if(file == INVALID_HANDLE_VALUE){
+        file = nullptr;
+        throw cRuntimeError("Cannot open trace file '%s'", fileName);
+    }
+    LARGE_INTEGER size;
+    GetFileSizeEx(file, &size);
+    length = size.QuadPart;
+    mapping = length > 0 ? CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL) : nullptr;
+    if(mapping) base = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+#else
+    int fd = open(fileName, O_RDONLY);
+    if(fd < 0)
+        throw cRuntimeError("Cannot open trace file '%s'", fileName);
+    struct stat st;
+    if(fstat(fd, &st) == 0 && st.st_size > 0){
+        length = st.st_size;
+        base = mmap(nullptr, length, PROT_READ, MAP_PRIVATE, fd, 0);
+        if(base == MAP_FAILED) base = nullptr;
+        else madvise((void *) base, length, MADV_SEQUENTIAL); // rounds are read in order
+    }
+    close(fd); // the mapping keeps the file
+#endif
+    if(!base && length > 0)
+        throw cRuntimeError("Cannot map trace file '%s'", fileName);
+
+    TraceHeader h;
+    if(length < sizeof(h) || memcmp(base, TRACE_MAGIC, sizeof(h.magic)))
+        throw cRuntimeError("'%s' is not a valid trace file", fileName);
+    memcpy(&h, base, sizeof(h));
+    if(h.version != TRACE_VERSION)
+        throw cRuntimeError("'%s' is not a valid trace file", fileName);
+    nodes = h.nodes;
+    rounds = h.rounds;
+    samples = h.samples;
+    data = (const float *) ((const char *) base + sizeof(h));
+    if(rounds == 0 || length < sizeof(h) + (size_t) rounds * nodes * samples * sizeof(float))
+        throw cRuntimeError("Trace file '%s' is truncated", fileName);
+    if(nodes < minNodes || samples < minSamples)
+        throw cRuntimeError("Trace file '%s' has %u nodes and %u samples per reading, %u and %u needed",
+                fileName, nodes, samples, minNodes, minSamples);
+}
+
+FileTrace::~FileTrace()
+{
+    const void *base = data ? (const char *) data - sizeof(TraceHeader) : nullptr;
+#ifdef _WIN32
+    if(base) UnmapViewOfFile(base);
+    if(mapping) CloseHandle(mapping);
+    if(file) CloseHandle(file);
+#else
+    if(base) munmap((void *) base, length);
+#endif
+}
+
+const float *FileTrace::read(int node, double x, double y, int round, unsigned int n)
+{
+    // the first n samples of the reading
+    return data + ((size_t) (round % rounds) * nodes + node) * samples;
+}
+
+// splitmix64, to draw the waves from the seed
+static uint64_t nextRandom(uint64_t &state)
+{
+    uint64_t z = (state += 0x9e3779b97f4a7c15ULL);
+    z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+    return z ^ (z >> 31);
+}
+
+static double uniform01(uint64_t &state)
+{
+    return (nextRandom(state) >> 11) * (1.0 / 9007199254740992.0);
+}
+
+void SyntheticTrace::setField(double edge, uint32_t s)
+{
+    seed = s;
+    noise = TRACE_NOISE;
+    uint64_t state = s;
+    waves.resize(TRACE_COMPONENTS);
+    for(unsigned int k = 0; k < waves.size(); k++){
+        // longer and slower waves carry more energy
+        double wavelength = edge * (0.5 + 2*uniform01(state)) / (k + 1);
+        double direction = 2*M_PI*uniform01(state);
+        double period = 60 * (0.5 + uniform01(state)) / (k + 1); // s
+        waves[k].kx = 2*M_PI / wavelength * cos(direction);
+        waves[k].ky = 2*M_PI / wavelength * sin(direction);
+        waves[k].omega = 2*M_PI / period;
+        waves[k].phase = 2*M_PI*uniform01(state);
+        waves[k].amplitude = 1.0f / (k + 1);
+    }
+    tableSamples = 0;
+}
+
+const float *SyntheticTrace::read(int node, double x, double y, int round, unsigned int n)
+{
+    unsigned int K = waves.size();
+    if(n != tableSamples){
+        cosTable.resize(K * n);
+        sinTable.resize(K * n);
+        for(unsigned int k = 0; k < K; k++)
+            for(unsigned int i = 0; i < n; i++){
+                cosTable[k*n + i] = cos(waves[k].omega * i * TRACE_SAMPLE_PERIOD);
+                sinTable[k*n + i] = sin(waves[k].omega * i * TRACE_SAMPLE_PERIOD);
+            }
+        tableSamples = n;
+    }
+    buf.resize(n);
+    float *__restrict out = buf.data();
+
+    // white noise in [-noise, noise): hash of (seed, node, round, i)
+    uint32_t key = seed ^ ((uint32_t) node * 0x9e3779b1u) ^ ((uint32_t) round * 0x85ebca77u);
+    for(unsigned int i = 0; i < n; i++){
+        uint32_t h = key + i * 0xc2b2ae3du;
+        h ^= h >> 16;
+        h *= 0x7feb352du;
+        h ^= h >> 15;
+        h *= 0x846ca68bu;
+        h ^= h >> 16;
+        out[i] = noise * ((int32_t) h * (1.0f / 2147483648.0f));
+    }
+
+    double t = round * TRACE_ROUND_PERIOD;
+    for(unsigned int k = 0; k < K; k++){
+        double p = waves[k].kx * x + waves[k].ky * y + waves[k].omega * t + waves[k].phase;
+        float s = waves[k].amplitude * sin(p), c = waves[k].amplitude * cos(p);
+        const float *__restrict ct = &cosTable[k*n], *__restrict st = &sinTable[k*n];
+        for(unsigned int i = 0; i < n; i++)
+            out[i] += s * ct[i] + c * st[i];
+    }
+    return out;
+}
@@ -0,0 +1,95 @@
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with this program.  If not, see http://www.gnu.org/licenses/.
+//
+
+#ifndef __IMPRO_LEACH_TRACE_H_
+#define __IMPRO_LEACH_TRACE_H_
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+/**
+ * Readings of the nodes: n samples of node for round r, in O(n) with no
+ * file I/O during the run. The pointer is valid until the next call.
+ */
+class TraceSource
+{
+  public:
+    virtual ~TraceSource() {}
+    virtual const float *read(int node, double x, double y, int round, unsigned int n) = 0;
+};
+
+/**
+ * Recorded readings, memory-mapped. The file is a header (TRACE_MAGIC,
+ * version, nodes, rounds, samples per reading as 32-bit integers) followed
+ * by float32 samples[rounds][nodes][samples]: the readings of a round are
+ * contiguous. Runs longer than the trace replay it from the first round.
+ */
+class FileTrace : public TraceSource
+{
+  private:
+    const float *data = nullptr;
+    size_t length = 0;          // mapped bytes
+    unsigned int nodes = 0, rounds = 0, samples = 0;
+#ifdef _WIN32
+    void *file = nullptr, *mapping = nullptr;
+#endif
+
+  public:
+    // throws if the file cannot be mapped or has less than minNodes nodes or minSamples samples
+    FileTrace(const char *fileName, unsigned int minNodes, unsigned int minSamples);
+    virtual ~FileTrace();
+    virtual const float *read(int node, double x, double y, int round, unsigned int n);
+
+    unsigned int getNodes() const { return nodes; }
+    unsigned int getRounds() const { return rounds; }
+    unsigned int getSamples() const { return samples; }
+};
+
+/**
+ * Synthetic field correlated in space and time: a sum of TRACE_COMPONENTS
+ * plane waves drifting over the area, plus white noise. A reading is
+ * TRACE_SAMPLE_PERIOD apart samples starting at round*TRACE_ROUND_PERIOD.
+ *
+ * The phase of each wave at the node and round costs one sin/cos pair;
+ * the samples are then sin(p + w*i*dt) = sin(p)cos(w*i*dt) + cos(p)sin(w*i*dt)
+ * from tables of the second factors, and the noise is a counter-based hash
+ * of (node, round, sample), so the loops over the samples vectorize and no
+ * state is kept between rounds.
+ */
+class SyntheticTrace : public TraceSource
+{
+  private:
+    struct Wave
+    {
+        double kx, ky;          // wave vector (rad/m)
+        double omega;           // angular frequency (rad/s)
+        double phase;
+        float amplitude;
+    };
+    std::vector<Wave> waves;
+    uint32_t seed = 0;
+    float noise = 0;
+    unsigned int tableSamples = 0;
+    std::vector<float> cosTable, sinTable; // [wave][sample]
+    std::vector<float> buf;
+
+  public:
+    // waves with wavelengths of the order of edge (m)
+    void setField(double edge, uint32_t seed);
+    virtual const float *read(int node, double x, double y, int round, unsigned int n);
+};
+
+#endif
@@ -0,0 +1,192 @@
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with this program.  If not, see http://www.gnu.org/licenses/.
+//
+
+//
+// leachtop: follow the per-round metrics a running simulation publishes
+// to its shared-memory ring (baseStation.metricsRing, see src/metrics.h).
+//
+// Rounds are printed as they complete, without pausing the simulation;
+// the ring is polled every interval. A new run on the same ring starts a
+// new table.
+//
+// usage: leachtop [-n backlog] [-i interval_ms] [-1] ring
+//   -n  rounds already in the ring to print first (default 10)
+//   -i  polling interval (default 200 ms)
+//   -1  print the last round and exit
+//
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <thread>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "metrics.h"
+
+struct Ring
+{
+    void *base = nullptr;
+    size_t length = 0;
+    const MetricsHeader *header = nullptr;
+    const MetricsSlot *slots = nullptr;
+    std::string run;
+};
+
+static bool mapRing(const char *fileName, Ring &r)
+{
+    if(r.base) munmap(r.base, r.length);
+    r.base = nullptr;
+    int fd = open(fileName, O_RDONLY);
+    if(fd < 0) return false;
+    struct stat st;
+    if(fstat(fd, &st) != 0 || (size_t) st.st_size < sizeof(MetricsHeader)){
+        close(fd);
+        return false;
+    }
+    r.length = st.st_size;
+    r.base = mmap(nullptr, r.length, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if(r.base == MAP_FAILED){
+        r.base = nullptr;
+        return false;
+    }
+    r.header = (const MetricsHeader *) r.base;
+    r.slots = (const MetricsSlot *) (r.header + 1);
+    if(memcmp(r.header->magic, METRICS_MAGIC, sizeof(r.header->magic)) || r.header->version != METRICS_VERSION
+            || r.length < sizeof(MetricsHeader) + (size_t) r.header->slots * sizeof(MetricsSlot)){
+        munmap(r.base, r.length);
+        r.base = nullptr;
+        return false;
+    }
+    std::atomic_thread_fence(std::memory_order_acquire);
+    r.run.assign(r.header->run, strnlen(r.header->run, sizeof(r.header->run)));
+    return true;
+}
+
+// copy of a slot, 0 if it is being written
+static uint64_t readSlot(const MetricsSlot &s, MetricsSlot &copy)
+{
+    uint64_t before = s.seq.load(std::memory_order_acquire);
+    if(before & 1) return 0;
+    copy.round = s.round;
+    copy.alive = s.alive;
+    copy.residualEnergy = s.residualEnergy;
+    copy.clusterHeads = s.clusterHeads;
+    copy.simTime = s.simTime;
+    copy.eventsPerSec = s.eventsPerSec;
+    copy.wallTime = s.wallTime;
+    std::atomic_thread_fence(std::memory_order_acquire);
+    return s.seq.load(std::memory_order_relaxed) == before ? before : 0;
+}
+
+// rounds published so far
+static uint64_t published(const Ring &r)
+{
+    uint64_t last = 0;
+    for(unsigned int i = 0; i < r.header->slots; i++)
+        last = std::max(last, r.slots[i].seq.load(std::memory_order_acquire) / 2);
+    return last;
+}
+
+static bool sameRun(const Ring &r)
+{
+    // the writer clears the magic while it resets the ring for a new run
+    return !memcmp(r.header->magic, METRICS_MAGIC, sizeof(r.header->magic))
+            && !strncmp(r.header->run, r.run.c_str(), sizeof(r.header->run));
+}
+
+static void printHeader(const Ring &r)
+{
+    printf("# run %s\n", r.run.c_str());
+    printf("%8s %6s %14s %5s %12s %12s %10s\n", "round", "alive", "energy(J)", "CHs", "events/s", "wall(ms)", "simtime(s)");
+}
+
+static void printSlot(const MetricsSlot &s)
+{
+    printf("%8d %6u %14.6f %5u %12.0f %12.3f %10.3f\n", s.round, s.alive, s.residualEnergy, s.clusterHeads,
+            s.eventsPerSec, 1000*s.wallTime, s.simTime);
+}
+
+int main(int argc, char **argv)
+{
+    uint64_t backlog = 10;
+    int interval = 200;
+    bool once = false;
+    int opt;
+    while((opt = getopt(argc, argv, "n:i:1")) != -1){
+        switch(opt){
+            case 'n': backlog = strtoull(optarg, nullptr, 10); break;
+            case 'i': interval = atoi(optarg); break;
+            case '1': once = true; break;
+            default:
+                fprintf(stderr, "usage: %s [-n backlog] [-i interval_ms] [-1] ring\n", argv[0]);
+                return 2;
+        }
+    }
+    if(optind + 1 != argc){
+        fprintf(stderr, "usage: %s [-n backlog] [-i interval_ms] [-1] ring\n", argv[0]);
+        return 2;
+    }
+    const char *fileName = argv[optind];
+
+    Ring r;
+    uint64_t next = 0;      // next round to print, in publication order
+    bool mapped = false;
+    while(true){
+        if(!mapped || !sameRun(r)){
+            mapped = mapRing(fileName, r);
+            if(!mapped){
+                if(once){
+                    fprintf(stderr, "%s: no metrics ring in '%s'\n", argv[0], fileName);
+                    return 1;
+                }
+                std::this_thread::sleep_for(std::chrono::milliseconds(interval));
+                continue;
+            }
+            uint64_t last = published(r);
+            next = last > backlog ? last - backlog : 0;
+            if(once) next = last > 0 ? last - 1 : 0;
+            printHeader(r);
+        }
+
+        uint64_t n = r.header->slots;
+        bool progress = false;
+        while(true){
+            MetricsSlot s;
+            uint64_t seq = readSlot(r.slots[next % n], s);
+            if(seq == 2*(next + 1)){
+                printSlot(s);
+                next++;
+                progress = true;
+            }
+            else if(seq > 2*(next + 1)){
+                // overwritten before we read it: skip to the oldest round still in the ring
+                uint64_t last = published(r);
+                next = last > n ? last - n + 1 : next + 1;
+            }
+            else
+                break;
+        }
+        if(progress) fflush(stdout);
+        if(once) return 0;
+        std::this_thread::sleep_for(std::chrono::milliseconds(interval));
+    }
+}
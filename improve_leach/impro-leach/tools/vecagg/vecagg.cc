@@ -0,0 +1,556 @@
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with this program.  If not, see http://www.gnu.org/licenses/.
+//
+
+//
+// vecagg: aggregate OMNeT++ output vectors of many replications per round.
+//
+// The .vci index of each run is used to locate the blocks of the wanted
+// vectors, which are then parsed straight from the memory-mapped .vec file
+// (runs with a missing or stale index are scanned once sequentially instead).
+// Runs are processed in parallel. Rounds are delimited by the samples of
+// a vector the BS records at the end of every round (aliveNodes by default;
+// rounds have variable length with frameColoring/adaptiveFrames), or by a
+// fixed roundTime. Each vector is sampled once per round
+// (last value of the round, held over rounds without samples) and the
+// samples of all vectors of all runs are reduced to mean, standard
+// deviation and quantiles. A vector is counted as alive from its first to
+// its last round, which gives the lifetime curve for battery vectors.
+//
+// usage: vecagg [-r roundPattern | -t roundTime] [-p pattern] [-q 0.05,0.5,0.95]
+//               [-B bins] [-j threads] [-o out.csv] [-b out.bin] run1.vec ...
+//
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+struct Block
+{
+    size_t offset, length;
+    double lastTime, min, max;
+    unsigned long count;
+};
+
+struct VectorInfo
+{
+    int id;
+    std::string columns;    // e.g. "ETV"
+    bool rounds = false;    // round boundaries, not aggregated
+    std::vector<Block> blocks;
+};
+
+struct RunIndex
+{
+    std::string vecFile;
+    std::vector<VectorInfo> vectors;    // selected vectors only
+    double min = INFINITY, max = -INFINITY, lastTime = 0;
+    unsigned long boundaries = 0;       // samples of the round vector
+};
+
+struct Options
+{
+    std::string pattern = "*.batteryLevel";
+    std::string roundPattern = "*.baseStation.aliveNodes"; // recorded at the end of each round
+    std::vector<double> quantiles = {0.05, 0.5, 0.95};
+    double roundTime = 0;               // fixed round length instead of roundPattern
+    unsigned int bins = 1000;
+    unsigned int threads = std::thread::hardware_concurrency();
+    std::string csvFile, binFile;
+    std::vector<std::string> files;
+};
+
+/**
+ * Per-round accumulator. Values are binned over the global [min,max] range
+ * of the selected vectors (known from the indices), so accumulators of
+ * different threads can be merged and quantiles need no sample storage.
+ */
+struct Accumulator
+{
+    unsigned int rounds, bins;
+    double min, width;
+    std::vector<double> sum, sumSq;
+    std::vector<unsigned long> n, alive;
+    std::vector<unsigned int> hist;     // rounds x bins
+
+    Accumulator(unsigned int rounds, unsigned int bins, double min, double max) :
+        rounds(rounds), bins(bins), min(min), width((max > min ? max - min : 1) / bins),
+        sum(rounds), sumSq(rounds), n(rounds), alive(rounds), hist((size_t) rounds * bins) {}
+
+    void collect(unsigned int r, double v)
+    {
+        if(r >= rounds) return;
+        sum[r] += v;
+        sumSq[r] += v*v;
+        n[r]++;
+        long b = (long) ((v - min) / width);
+        b = std::max(0L, std::min((long) bins - 1, b));
+        hist[(size_t) r * bins + b]++;
+    }
+
+    void merge(const Accumulator &o)
+    {
+        for(unsigned int r = 0; r < rounds; r++){
+            sum[r] += o.sum[r];
+            sumSq[r] += o.sumSq[r];
+            n[r] += o.n[r];
+            alive[r] += o.alive[r];
+        }
+        for(size_t i = 0; i < hist.size(); i++)
+            hist[i] += o.hist[i];
+    }
+
+    double quantile(unsigned int r, double q) const
+    {
+        if(n[r] == 0) return NAN;
+        double target = q * n[r];
+        double cum = 0;
+        const unsigned int *h = &hist[(size_t) r * bins];
+        for(unsigned int b = 0; b < bins; b++){
+            if(h[b] > 0 && cum + h[b] >= target)
+                return min + width * (b + (target - cum) / h[b]); // linear within the bin
+            cum += h[b];
+        }
+        return min + width * bins;
+    }
+};
+
+/********* Index parsing **********/
+static std::vector<std::string> tokenize(const std::string &line)
+{
+    std::vector<std::string> tokens;
+    size_t i = 0;
+    while(i < line.size()){
+        while(i < line.size() && isspace((unsigned char) line[i])) i++;
+        if(i >= line.size()) break;
+        std::string tok;
+        if(line[i] == '"'){
+            for(i++; i < line.size() && line[i] != '"'; i++){
+                if(line[i] == '\\' && i+1 < line.size()) i++;
+                tok += line[i];
+            }
+            i++;
+        }
+        else{
+            while(i < line.size() && !isspace((unsigned char) line[i])) tok += line[i++];
+        }
+        tokens.push_back(tok);
+    }
+    return tokens;
+}
+
+// glob match where only '*' and '?' are special (so "node[*]" matches literally)
+static bool globMatch(const char *p, const char *s)
+{
+    const char *star = nullptr, *ss = nullptr;
+    while(*s){
+        if(*p == '?' || *p == *s) { p++; s++; }
+        else if(*p == '*') { star = p++; ss = s; }
+        else if(star) { p = star + 1; s = ++ss; }
+        else return false;
+    }
+    while(*p == '*') p++;
+    return *p == 0;
+}
+
+static bool vectorMatches(const std::string &pattern, const std::string &module, const std::string &name)
+{
+    // match both "module.name:recordingmode" and "module.name"
+    std::string full = module + "." + name;
+    if(globMatch(pattern.c_str(), full.c_str())) return true;
+    size_t colon = name.find(':');
+    if(colon == std::string::npos) return false;
+    full = module + "." + name.substr(0, colon);
+    return globMatch(pattern.c_str(), full.c_str());
+}
+
+static void selectVector(RunIndex &idx, std::vector<int> &selected, const std::string &line, const Options &opt)
+{
+    // "vector <id> <module> <name> [<columns>]"
+    std::vector<std::string> t = tokenize(line);
+    if(t.size() < 4) return;
+    int id = atoi(t[1].c_str());
+    if(id >= (int) selected.size()) selected.resize(id+1, -1);
+    bool rounds = opt.roundTime <= 0 && vectorMatches(opt.roundPattern, t[2], t[3]);
+    if(rounds || vectorMatches(opt.pattern, t[2], t[3])){
+        VectorInfo v;
+        v.id = id;
+        v.columns = t.size() > 4 ? t[4] : "TV";
+        v.rounds = rounds;
+        selected[id] = idx.vectors.size();
+        idx.vectors.push_back(v);
+    }
+}
+
+static void addBlock(RunIndex &idx, VectorInfo &v, const Block &b)
+{
+    v.blocks.push_back(b);
+    if(v.rounds){
+        idx.boundaries += b.count;
+        return;
+    }
+    idx.min = std::min(idx.min, b.min);
+    idx.max = std::max(idx.max, b.max);
+    idx.lastTime = std::max(idx.lastTime, b.lastTime);
+}
+
+static bool readIndex(RunIndex &idx, const Options &opt)
+{
+    std::string vciFile = idx.vecFile.substr(0, idx.vecFile.size() - 4) + ".vci";
+    std::ifstream in(vciFile);
+    if(!in)
+        return false;
+
+    // "file <size> <mtime>": the index is stale if the size does not match
+    std::string line;
+    struct stat st;
+    if(!std::getline(in, line) || line.compare(0, 5, "file ") != 0 || stat(idx.vecFile.c_str(), &st) != 0)
+        return false;
+    if(strtoull(line.c_str() + 5, nullptr, 10) != (unsigned long long) st.st_size)
+        return false;
+
+    std::vector<int> selected;  // vector id -> position in idx.vectors (-1 if not selected)
+    while(std::getline(in, line)){
+        if(line.empty()) continue;
+        if(isdigit((unsigned char) line[0])){
+            // block line: id offset length firstEvent lastEvent firstTime lastTime count min max sum sumsqr
+            char *p;
+            long id = strtol(line.c_str(), &p, 10);
+            if(id < 0 || id >= (long) selected.size() || selected[id] < 0) continue;
+            Block b;
+            b.offset = strtoull(p, &p, 10);
+            b.length = strtoull(p, &p, 10);
+            strtoll(p, &p, 10);
+            strtoll(p, &p, 10);
+            strtod(p, &p);
+            b.lastTime = strtod(p, &p);
+            b.count = strtoull(p, &p, 10);
+            b.min = strtod(p, &p);
+            b.max = strtod(p, &p);
+            addBlock(idx, idx.vectors[selected[id]], b);
+        }
+        else if(line.compare(0, 7, "vector ") == 0)
+            selectVector(idx, selected, line, opt);
+    }
+    return true;
+}
+
+/********* Vector parsing **********/
+// parse a number in [p,end) and advance p; the mapped file is not NUL-terminated
+static double parseField(const char *&p, const char *end)
+{
+    while(p < end && (*p == ' ' || *p == '\t')) p++;
+    char buf[64];
+    size_t len = 0;
+    while(p < end && !isspace((unsigned char) *p) && len < sizeof(buf)-1) buf[len++] = *p++;
+    buf[len] = 0;
+    return strtod(buf, nullptr);
+}
+
+class MappedFile
+{
+  public:
+    const char *data = nullptr;
+    size_t size = 0;
+
+    explicit MappedFile(const std::string &file)
+    {
+        int fd = open(file.c_str(), O_RDONLY);
+        if(fd < 0) throw std::runtime_error("cannot open " + file);
+        struct stat st;
+        if(fstat(fd, &st) == 0) size = st.st_size;
+        if(size > 0){
+            void *m = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+            if(m == MAP_FAILED){ close(fd); throw std::runtime_error("cannot map " + file); }
+            data = (const char *) m;
+        }
+        close(fd);
+    }
+    ~MappedFile() { if(data) munmap((void *) data, size); }
+};
+
+// Without a valid index, build the block list with one sequential pass over the .vec file.
+static void scanVec(RunIndex &idx, const Options &opt)
+{
+    MappedFile vec(idx.vecFile);
+    std::vector<int> selected;
+    const char *p = vec.data, *end = vec.data + vec.size;
+    while(p < end){
+        const char *eol = (const char *) memchr(p, '\n', end - p);
+        if(!eol) eol = end;
+        const char *line = p;
+        if(isdigit((unsigned char) *p)){
+            long id = (long) parseField(p, eol);
+            if(id < (long) selected.size() && selected[id] >= 0){
+                VectorInfo &v = idx.vectors[selected[id]];
+                double t = 0, value = 0;
+                for(size_t c = 0; c < v.columns.size(); c++){
+                    double f = parseField(p, eol);
+                    if(v.columns[c] == 'T') t = f;
+                    else if(v.columns[c] == 'V') value = f;
+                }
+                size_t offset = line - vec.data, length = eol + 1 - line;
+                Block *b = v.blocks.empty() ? nullptr : &v.blocks.back();
+                if(b && b->offset + b->length == offset){
+                    // consecutive lines of the same vector extend the block
+                    b->length += length;
+                    b->lastTime = t;
+                    b->min = std::min(b->min, value);
+                    b->max = std::max(b->max, value);
+                    b->count++;
+                    if(v.rounds)
+                        idx.boundaries++;
+                    else{
+                        idx.min = std::min(idx.min, value);
+                        idx.max = std::max(idx.max, value);
+                        idx.lastTime = std::max(idx.lastTime, t);
+                    }
+                }
+                else
+                    addBlock(idx, v, Block{offset, length, t, value, value, 1});
+            }
+        }
+        else if(eol - p > 7 && strncmp(p, "vector ", 7) == 0)
+            selectVector(idx, selected, std::string(p, eol), opt);
+        p = eol + 1;
+    }
+}
+
+// calls f(t, value) for each sample of v
+template<class F>
+static void forEachSample(const RunIndex &idx, const MappedFile &vec, const VectorInfo &v, F f)
+{
+    size_t timeCol = v.columns.find('T');
+    size_t valueCol = v.columns.find('V');
+    if(timeCol == std::string::npos || valueCol == std::string::npos) return;
+    for(const Block &b : v.blocks){
+        if(b.offset + b.length > vec.size)
+            throw std::runtime_error(idx.vecFile + " is shorter than its index");
+        const char *p = vec.data + b.offset, *end = p + b.length;
+        while(p < end){
+            const char *eol = (const char *) memchr(p, '\n', end - p);
+            if(!eol) eol = end;
+            parseField(p, eol); // vector id
+            double t = 0, value = 0;
+            for(size_t c = 0; c < v.columns.size(); c++){
+                double x = parseField(p, eol);
+                if(c == timeCol) t = x;
+                else if(c == valueCol) value = x;
+            }
+            f(t, value);
+            p = eol + 1;
+        }
+    }
+}
+
+static void processRun(const RunIndex &idx, const Options &opt, Accumulator &acc)
+{
+    MappedFile vec(idx.vecFile);
+
+    // end of each round; samples at a boundary belong to the next round
+    std::vector<double> bounds;
+    if(opt.roundTime <= 0){
+        for(const VectorInfo &v : idx.vectors)
+            if(v.rounds) forEachSample(idx, vec, v, [&](double t, double) { bounds.push_back(t); });
+        if(bounds.empty())
+            throw std::runtime_error(idx.vecFile + " has no round vector '" + opt.roundPattern + "' (use -t)");
+        std::sort(bounds.begin(), bounds.end());
+    }
+
+    for(const VectorInfo &v : idx.vectors){
+        if(v.rounds) continue;
+
+        long round = -1, firstRound = -1;
+        double last = 0;
+        forEachSample(idx, vec, v, [&](double t, double value) {
+            long r = opt.roundTime > 0 ? (long) floor(t / opt.roundTime)
+                    : std::upper_bound(bounds.begin(), bounds.end(), t) - bounds.begin();
+            if(round < 0) firstRound = r;
+            // hold the last value of each round until the next sample
+            for(long h = round; round >= 0 && h < r; h++)
+                acc.collect(h, last);
+            round = r;
+            last = value;
+        });
+        if(round < 0) continue;
+        acc.collect(round, last);
+        for(long r = firstRound; r <= round && r < (long) acc.rounds; r++)
+            acc.alive[r]++;
+    }
+}
+
+/********* Output **********/
+static void writeResults(const Options &opt, const Accumulator &acc, unsigned int runs)
+{
+    std::vector<std::string> cols = {"round", "n", "mean", "stddev"};
+    for(double q : opt.quantiles){
+        char name[32];
+        snprintf(name, sizeof(name), "q%g", q);
+        cols.push_back(name);
+    }
+    cols.push_back("alive");
+
+    std::vector<double> table;
+    for(unsigned int r = 0; r < acc.rounds; r++){
+        double n = acc.n[r];
+        double mean = n ? acc.sum[r] / n : NAN;
+        double var = n > 1 ? (acc.sumSq[r] - n*mean*mean) / (n - 1) : 0;
+        table.push_back(r);
+        table.push_back(n);
+        table.push_back(mean);
+        table.push_back(sqrt(std::max(0.0, var)));
+        for(double q : opt.quantiles)
+            table.push_back(acc.quantile(r, q));
+        table.push_back((double) acc.alive[r] / runs);   // mean alive vectors per run
+    }
+
+    if(!opt.csvFile.empty()){
+        FILE *f = opt.csvFile == "-" ? stdout : fopen(opt.csvFile.c_str(), "w");
+        if(!f) throw std::runtime_error("cannot write " + opt.csvFile);
+        for(size_t c = 0; c < cols.size(); c++)
+            fprintf(f, "%s%s", c ? "," : "", cols[c].c_str());
+        fprintf(f, "\n");
+        for(size_t i = 0; i < table.size(); i++)
+            fprintf(f, "%.10g%s", table[i], (i+1) % cols.size() ? "," : "\n");
+        if(f != stdout) fclose(f);
+    }
+
+    if(!opt.binFile.empty()){
+        // "VECAGG1\0", uint32 rows, uint32 cols, NUL-terminated column names, row-major doubles
+        FILE *f = fopen(opt.binFile.c_str(), "wb");
+        if(!f) throw std::runtime_error("cannot write " + opt.binFile);
+        uint32_t rows = acc.rounds, ncols = cols.size();
+        fwrite("VECAGG1", 8, 1, f);
+        fwrite(&rows, sizeof(rows), 1, f);
+        fwrite(&ncols, sizeof(ncols), 1, f);
+        for(const std::string &c : cols)
+            fwrite(c.c_str(), c.size() + 1, 1, f);
+        fwrite(table.data(), sizeof(double), table.size(), f);
+        fclose(f);
+    }
+}
+
+static void usage()
+{
+    fprintf(stderr,
+        "usage: vecagg [options] run1.vec [run2.vec ...]\n"
+        "  -r pattern     vector recorded at the end of each round, whose samples delimit\n"
+        "                 the rounds (default: *.baseStation.aliveNodes)\n"
+        "  -t roundTime   fixed duration of one round (s) instead of -r\n"
+        "  -p pattern     vectors to aggregate, '*' and '?' wildcards (default: *.batteryLevel)\n"
+        "  -q list        comma-separated quantiles (default: 0.05,0.5,0.95)\n"
+        "  -B bins        histogram bins used for quantiles (default: 1000)\n"
+        "  -j threads     runs processed in parallel (default: all cores)\n"
+        "  -o file        CSV output ('-' for stdout, the default)\n"
+        "  -b file        binary output\n");
+    exit(1);
+}
+
+static Options parseArgs(int argc, char **argv)
+{
+    Options opt;
+    for(int i = 1; i < argc; i++){
+        std::string a = argv[i];
+        bool hasValue = i+1 < argc;
+        if(a == "-t" && hasValue) opt.roundTime = atof(argv[++i]);
+        else if(a == "-p" && hasValue) opt.pattern = argv[++i];
+        else if(a == "-r" && hasValue) opt.roundPattern = argv[++i];
+        else if(a == "-B" && hasValue) opt.bins = atoi(argv[++i]);
+        else if(a == "-j" && hasValue) opt.threads = atoi(argv[++i]);
+        else if(a == "-o" && hasValue) opt.csvFile = argv[++i];
+        else if(a == "-b" && hasValue) opt.binFile = argv[++i];
+        else if(a == "-q" && hasValue){
+            opt.quantiles.clear();
+            std::stringstream ss(argv[++i]);
+            std::string q;
+            while(std::getline(ss, q, ',')) opt.quantiles.push_back(atof(q.c_str()));
+        }
+        else if(a[0] == '-') usage();
+        else opt.files.push_back(a);
+    }
+    if(opt.files.empty() || opt.bins == 0) usage();
+    if(opt.threads == 0) opt.threads = 1;
+    if(opt.csvFile.empty() && opt.binFile.empty()) opt.csvFile = "-";
+    return opt;
+}
+
+int main(int argc, char **argv)
+{
+    Options opt = parseArgs(argc, argv);
+    try{
+        // the indices are small: read them all first to size the accumulators
+        std::vector<RunIndex> runs;
+        double min = INFINITY, max = -INFINITY, lastTime = 0;
+        unsigned long boundaries = 0;
+        for(const std::string &f : opt.files){
+            if(f.size() < 4 || f.compare(f.size() - 4, 4, ".vec") != 0)
+                throw std::runtime_error(f + " is not a .vec file");
+            runs.emplace_back();
+            runs.back().vecFile = f;
+            if(!readIndex(runs.back(), opt)){
+                fprintf(stderr, "vecagg: no valid index for %s, scanning it\n", f.c_str());
+                scanVec(runs.back(), opt);
+            }
+            boundaries = std::max(boundaries, runs.back().boundaries);
+            min = std::min(min, runs.back().min);
+            max = std::max(max, runs.back().max);
+            lastTime = std::max(lastTime, runs.back().lastTime);
+        }
+        if(min > max)
+            throw std::runtime_error("no vector matches '" + opt.pattern + "'");
+        unsigned int rounds = opt.roundTime > 0 ? (unsigned int) floor(lastTime / opt.roundTime) + 1 : boundaries + 1;
+
+        unsigned int nthreads = std::min<size_t>(opt.threads, runs.size());
+        std::vector<Accumulator> acc(nthreads, Accumulator(rounds, opt.bins, min, max));
+        std::vector<std::string> errors(nthreads);
+        std::atomic<size_t> next(0);
+        std::vector<std::thread> workers;
+        for(unsigned int t = 0; t < nthreads; t++){
+            workers.emplace_back([&, t]() {
+                try{
+                    for(size_t i = next++; i < runs.size(); i = next++)
+                        processRun(runs[i], opt, acc[t]);
+                }
+                catch(std::exception &e){
+                    errors[t] = e.what();
+                }
+            });
+        }
+        for(std::thread &w : workers) w.join();
+        for(unsigned int t = 0; t < nthreads; t++){
+            if(!errors[t].empty()) throw std::runtime_error(errors[t]);
+            if(t > 0) acc[0].merge(acc[t]);
+        }
+
+        writeResults(opt, acc[0], runs.size());
+    }
+    catch(std::exception &e){
+        fprintf(stderr, "vecagg: %s\n", e.what());
+        return 1;
+    }
+    return 0;
+}